@@ -0,0 +1,653 @@
+#pragma once
+
+/*
+ *  File: adpcm.h
+ *
+ *  4-bit IMA-ADPCM storage for the recorded buffer, 8 times the recording
+ *  time of the float buffer. Define SAMPLE_STORAGE_ADPCM (e.g. in UDEFS) to
+ *  use it instead of the linear store, see sample_store.h.
+ *
+ *  Each level holds one nibble per sample, the earlier one in the low nibble,
+ *  so a stereo frame is a byte with the left code in the low nibble. A seek
+ *  table holds the decoder state at the start of every block of BLOCK_BYTES
+ *  bytes. A reader can start anywhere by decoding at most one block, then
+ *  runs forward decoding into a small window that the interpolators read as
+ *  Q15. Mip levels are decimated from the decoded level above and encoded in
+ *  turn.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+#include "utils/int_math.h" // for clipmaxu32()
+#include "interpolator.h"
+#include "mipmap.h"
+#include "sample_format.h"
+#include "vector_ops.h"
+
+// Decoder state of one channel
+struct AdpcmState
+{
+  int16_t predictor;
+  uint8_t index; // into adpcm_steps()
+};
+
+// Decoder state of both channels at the start of a block, the second one is
+// unused in mono
+struct AdpcmSeek
+{
+  AdpcmState ch[2];
+};
+
+enum
+{
+  ADPCM_NUM_STEPS = 89,
+};
+
+fast_inline const int16_t *adpcm_steps()
+{
+  static const int16_t t[ADPCM_NUM_STEPS] = {
+      7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+      31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+      544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+      2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+      9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+  };
+  return t;
+}
+
+// Per step index and code magnitude (code & 7): the magnitude it decodes to
+// and the next step index. Filled by adpcm_init().
+struct AdpcmTables
+{
+  int16_t delta[ADPCM_NUM_STEPS][8];
+  uint8_t next[ADPCM_NUM_STEPS][8];
+};
+
+fast_inline AdpcmTables &adpcm_tables()
+{
+  static AdpcmTables t;
+  return t;
+}
+
+// Must be called once before encoding or decoding.
+inline void adpcm_init()
+{
+  static const int8_t index_adjust[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+  AdpcmTables &t = adpcm_tables();
+  for (int32_t index = 0; index < ADPCM_NUM_STEPS; ++index)
+  {
+    const int32_t step = adpcm_steps()[index];
+    for (uint32_t code = 0; code < 8; ++code)
+    {
+      int32_t delta = step >> 3;
+      if (code & 4)
+        delta += step;
+      if (code & 2)
+        delta += step >> 1;
+      if (code & 1)
+        delta += step >> 2;
+      const int32_t next = index + index_adjust[code];
+      t.delta[index][code] = (int16_t)delta;
+      t.next[index][code] = (uint8_t)((next < 0) ? 0 : (next > ADPCM_NUM_STEPS - 1) ? ADPCM_NUM_STEPS - 1 : next);
+    }
+  }
+}
+
+// Note: no branches on the codes, which are too random for the branch
+//       predictor
+
+fast_inline int16_t adpcm_decode(AdpcmState &s, uint32_t code)
+{
+  const AdpcmTables &t = adpcm_tables();
+  const uint32_t magnitude = code & 7;
+  const int32_t sign = -(int32_t)(code >> 3); // 0 or -1
+  int32_t predictor = s.predictor + ((t.delta[s.index][magnitude] ^ sign) - sign);
+  predictor = (predictor < -32768) ? -32768 : (predictor > 32767) ? 32767 : predictor;
+  s.predictor = (int16_t)predictor;
+  s.index = t.next[s.index][magnitude];
+  return s.predictor;
+}
+
+// Encode x, updating s as the decoder will. Returns the 4-bit code.
+fast_inline uint32_t adpcm_encode(AdpcmState &s, int32_t x)
+{
+  const int32_t step = adpcm_steps()[s.index];
+  int32_t diff = x - s.predictor;
+  const int32_t sign = diff >> 31; // 0 or -1
+  diff = (diff ^ sign) - sign;
+  // Successive approximation of 4 * diff / step, 3 bits
+  const int32_t m2 = -(int32_t)(diff >= step);
+  diff -= step & m2;
+  const int32_t m1 = -(int32_t)(diff >= (step >> 1));
+  diff -= (step >> 1) & m1;
+  const int32_t m0 = -(int32_t)(diff >= (step >> 2));
+  const uint32_t code = (sign & 8) | (m2 & 4) | (m1 & 2) | (m0 & 1);
+  adpcm_decode(s, code);
+  return code;
+}
+
+// What is encoded: Q15 rounded without dither, the encoder adds far more
+// noise than dither would hide.
+struct AdpcmPcm
+{
+  typedef int16_t sample_t;
+
+  static fast_inline float load(sample_t s)
+  {
+    return s;
+  }
+
+  static fast_inline sample_t quantize(float x, uint32_t &seed)
+  {
+    (void)seed;
+    x = (x < -32768.f) ? -32768.f : (x > 32767.f) ? 32767.f : x;
+    // Note: round half up, by truncating a value made positive
+    return (sample_t)((int32_t)(x + 32768.5f) - 32768);
+  }
+};
+
+// Recorded buffer and mip levels as ADPCM, with one decoding reader per
+// voice and per mip level built. Same interface as LinearStore.
+template <uint32_t Voices>
+class AdpcmStore
+{
+public:
+  typedef SampleQ15 format_t; // of the decoded windows
+  typedef int16_t sample_t;
+
+  enum
+  {
+    // Most bytes decoded to seek, 64 stereo or 128 mono frames, ~1.3 ms or
+    // ~2.7 ms at 48 kHz
+    BLOCK_BYTES = 64,
+    // Most codes for the recorded buffer, the mip levels and seek tables
+    // take a little less again
+    MAX_LEVEL_BYTES = 0x400000,
+    MAX_FRAMES = MAX_LEVEL_BYTES, // stereo
+    // Buffer sizes are multiples of MIN_FRAMES, so every level holds whole
+    // blocks
+    MIN_FRAMES = MAX_FRAMES / 16,
+    // Bytes of SDRAM cleared per clearProgressive() call
+    CLEAR_BUDGET_BYTES = 4096,
+    // Frames readers may look past the end of what was written
+    GUARD_FRAMES = ((int)INTERP_GUARD_FRAMES > (int)HalfbandDecimator::HALF_TAPS) ? (int)INTERP_GUARD_FRAMES : (int)HalfbandDecimator::HALF_TAPS,
+    // Decoded frames a reader holds
+    WINDOW_FRAMES = 256,
+    NUM_READERS = Voices + NUM_MIP_LEVELS - 1,
+    // Note: codes depend on the whole block before them, an overdub would
+    //       re-encode every block it touches
+    CAN_OVERDUB = 0,
+  };
+
+  static uint32_t bytes(uint32_t frames)
+  {
+    uint32_t total = 0;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      total += (frames >> level) + ((frames >> level) / BLOCK_BYTES) * sizeof(AdpcmSeek);
+    // Reader windows, plus one for conversions
+    return total + (NUM_READERS + 1) * WINDOW_FRAMES * 2 * sizeof(sample_t);
+  }
+
+  // Stereo frames of the recorded buffer
+  fast_inline uint32_t frames() const
+  {
+    return bytes_;
+  }
+
+  fast_inline uint32_t channels() const
+  {
+    return channels_;
+  }
+
+  fast_inline uint32_t levelBytes(uint32_t level) const
+  {
+    return bytes_ >> level;
+  }
+
+  fast_inline uint32_t levelFrames(uint32_t level) const
+  {
+    return levelBytes(level) * 2 / channels_;
+  }
+
+  // A ring take starts on a block of every level, older frames in the block
+  // were overwritten
+  fast_inline uint32_t alignFrames() const
+  {
+    return ((BLOCK_BYTES * 2) / channels_) << (NUM_MIP_LEVELS - 1);
+  }
+
+  // Note: memory is not cleared here, which would stall loading. It is
+  //       cleared ahead of the writers and progressively by
+  //       clearProgressive(), so unwritten blocks decode to silence.
+  inline void init(void *mem, uint32_t frames)
+  {
+    bytes_ = frames;
+    uint8_t *m = (uint8_t *)mem;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      // Note: seek tables first, codes only need byte alignment
+      seek_[level] = (AdpcmSeek *)m;
+      m += (levelBytes(level) / BLOCK_BYTES) * sizeof(AdpcmSeek);
+      codes_[level] = m;
+      m += levelBytes(level);
+      clean_bytes_[level] = 0;
+    }
+    sample_t *w = (sample_t *)m;
+    for (uint32_t r = 0; r < NUM_READERS; ++r, w += WINDOW_FRAMES * 2)
+      readers_[r].window = w;
+    scratch_ = w;
+    ring_ = false;
+    channels_ = 2;
+    invalidate();
+    adpcm_init();
+  }
+
+  inline void teardown()
+  {
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      codes_[level] = nullptr;
+      seek_[level] = nullptr;
+    }
+  }
+
+  // Start over for a new recording, ring or not, of 1 or 2 channels.
+  inline void reset(bool ring, uint32_t channels)
+  {
+    ring_ = ring;
+    channels_ = channels;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      writers_[level][0] = writers_[level][1] = AdpcmState();
+    invalidate();
+  }
+
+  // Drop every decoded window, the levels were written since.
+  inline void invalidate()
+  {
+    for (uint32_t r = 0; r < NUM_READERS; ++r)
+      readers_[r].level = NUM_MIP_LEVELS;
+  }
+
+  inline bool isClearing() const
+  {
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      if (clean_bytes_[level] < levelBytes(level))
+        return true;
+    return false;
+  }
+
+  inline void clearProgressive()
+  {
+    uint32_t budget = CLEAR_BUDGET_BYTES;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS && budget; ++level)
+    {
+      const uint32_t capacity = levelBytes(level);
+      const uint32_t clean = clean_bytes_[level];
+      if (clean >= capacity)
+        continue;
+      const uint32_t n = (capacity - clean < budget) ? capacity - clean : budget;
+      clear(level, clean, clean + n);
+      clean_bytes_[level] = clean + n;
+      budget -= n;
+    }
+  }
+
+  // Encode frames stereo frames of in at frame of level 0.
+  inline void write(const float *in, uint32_t frame, uint32_t frames)
+  {
+    if (channels_ == 1)
+      writeFrames<1>(in, frame, frames);
+    else
+      writeFrames<2>(in, frame, frames);
+  }
+
+  // A one shot take ends at frame end of a level, see LinearStore::endTake().
+  inline void endTake(uint32_t level, uint32_t end)
+  {
+    if (channels_ == 1)
+      endTakeFrames<1>(level, end);
+    else
+      endTakeFrames<2>(level, end);
+  }
+
+  // Not supported, see CAN_OVERDUB
+  inline void overdub(const float *in, float *out, uint32_t frame, uint32_t frames, float feedback,
+                      float feedback_inc)
+  {
+    (void)in;
+    (void)out;
+    (void)frame;
+    (void)frames;
+    (void)feedback;
+    (void)feedback_inc;
+  }
+
+  // Compute frames [begin, end) of a level from the decoded level above.
+  inline void decimate(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    if (channels_ == 1)
+      decimateFrames<1>(level, begin, end);
+    else
+      decimateFrames<2>(level, begin, end);
+  }
+
+  // Decoded window a voice reads frames frames of a level from, and phase
+  // relative to it, in the layout of Channels channels. Lowers frames to what
+  // fits in the window.
+  template <uint32_t Channels>
+  fast_inline const sample_t *read(uint32_t voice, uint32_t level, uint64_t &phase, uint64_t phase_inc,
+                                   uint32_t &frames)
+  {
+    // Frames spanned by n frames are at most (n - 1) * phase_inc + 1, plus
+    // what the interpolators read around them
+    const uint64_t fit = ((uint64_t)(WINDOW_FRAMES - 2 * INTERP_GUARD_FRAMES - 2) << 32) / phase_inc + 1;
+    if (fit < frames)
+      frames = (uint32_t)fit;
+    const int32_t lo = (int32_t)(phase >> 32) - INTERP_GUARD_FRAMES;
+    const int32_t hi = (int32_t)((phase + (frames - 1) * phase_inc) >> 32) + INTERP_GUARD_FRAMES + 1;
+    Reader &r = readers_[voice];
+    const sample_t *w = fill<Channels>(r, level, lo, hi);
+    phase -= (uint64_t)(int64_t)r.first << 32;
+    return w;
+  }
+
+private:
+  // Decodes a level forward into its window. Frames are counted from the
+  // start of the level, past its ends in ring mode they are those at the
+  // other end.
+  struct Reader
+  {
+    sample_t *window;
+    uint32_t level; // NUM_MIP_LEVELS when the window is empty
+    int32_t first;  // frame of window[0]
+    int32_t end;    // frame after the last one decoded
+    bool synced;    // state is the one to decode frame end with
+    AdpcmState state[2];
+  };
+
+  AdpcmSeek *seek_[NUM_MIP_LEVELS];
+  uint8_t *codes_[NUM_MIP_LEVELS];
+  uint32_t bytes_; // of level 0 codes
+
+  // For each level, bytes [0, clean_bytes_) hold recorded or cleared data
+  uint32_t clean_bytes_[NUM_MIP_LEVELS];
+
+  AdpcmState writers_[NUM_MIP_LEVELS][2];
+  Reader readers_[NUM_READERS];
+  sample_t *scratch_; // WINDOW_FRAMES stereo frames
+
+  bool ring_;
+  uint32_t channels_;
+
+  template <uint32_t Channels>
+  inline void writeFrames(const float *in, uint32_t frame, uint32_t frames)
+  {
+    const uint32_t end = frame + frames;
+    uint32_t seed = 0; // unused, AdpcmPcm does not dither
+    while (frame < end)
+    {
+      const uint32_t n = clipmaxu32(end - frame, WINDOW_FRAMES);
+      if (Channels == 1)
+      {
+        for (uint32_t i = 0; i < n; ++i)
+          scratch_[i] = AdpcmPcm::quantize((in[2 * i] + in[2 * i + 1]) * 16384.f, seed);
+      }
+      else
+      {
+        for (uint32_t i = 0; i < n << 1; ++i)
+          scratch_[i] = AdpcmPcm::quantize(in[i] * 32768.f, seed);
+      }
+      encode<Channels>(0, frame, scratch_, n);
+      in += n << 1;
+      frame += n;
+    }
+    markWritten(0, end);
+  }
+
+  template <uint32_t Channels>
+  inline void decimateFrames(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    enum
+    {
+      HALF_TAPS = HalfbandDecimator::HALF_TAPS,
+      // Most frames computed from one window
+      CHUNK_FRAMES = (WINDOW_FRAMES - 2 * HALF_TAPS - 1) / 2,
+    };
+    Reader &r = readers_[Voices + level - 1];
+    uint32_t seed = 0;
+    while (begin < end)
+    {
+      const uint32_t n = clipmaxu32(end - begin, CHUNK_FRAMES);
+      const int32_t center = (int32_t)(begin << 1);
+      const sample_t *w =
+          fill<Channels>(r, level - 1, center - HALF_TAPS, center + (int32_t)((n - 1) << 1) + HALF_TAPS + 1);
+      HalfbandDecimator::process<AdpcmPcm, Channels>(w + (center - r.first) * (int32_t)Channels, scratch_, 0, n,
+                                                     seed);
+      encode<Channels>(level, begin, scratch_, n);
+      begin += n;
+    }
+    markWritten(level, end);
+  }
+
+  // Encode n Q15 frames of src at frame of a level.
+  template <uint32_t Channels>
+  inline void encode(uint32_t level, uint32_t frame, const sample_t *src, uint32_t n)
+  {
+    enum
+    {
+      BLOCK_FRAMES = BLOCK_BYTES * 2 / Channels,
+    };
+    AdpcmState l = writers_[level][0];
+    AdpcmState r = writers_[level][1];
+    uint8_t *codes = codes_[level];
+    AdpcmSeek *seek = seek_[level];
+    for (uint32_t i = 0; i < n; ++i, ++frame, src += Channels)
+    {
+      if (!(frame & (BLOCK_FRAMES - 1)))
+      {
+        seek[frame / BLOCK_FRAMES].ch[0] = l;
+        seek[frame / BLOCK_FRAMES].ch[1] = r;
+      }
+      if (Channels == 1)
+      {
+        // Note: the low nibble is written first, clearing the high one
+        const uint32_t code = adpcm_encode(l, src[0]);
+        if (frame & 1)
+          codes[frame >> 1] = (uint8_t)((codes[frame >> 1] & 15) | (code << 4));
+        else
+          codes[frame >> 1] = (uint8_t)code;
+      }
+      else
+      {
+        codes[frame] = (uint8_t)(adpcm_encode(l, src[0]) | (adpcm_encode(r, src[1]) << 4));
+      }
+    }
+    writers_[level][0] = l;
+    writers_[level][1] = r;
+  }
+
+  // Encode silence over the GUARD_FRAMES frames past end, continuing from the
+  // decoder state there so the take decays to zero instead of running into
+  // the codes of an earlier take.
+  template <uint32_t Channels>
+  inline void endTakeFrames(uint32_t level, uint32_t end)
+  {
+    enum
+    {
+      BLOCK_FRAMES = BLOCK_BYTES * 2 / Channels,
+    };
+    const uint32_t e = clipmaxu32(end + GUARD_FRAMES, levelFrames(level));
+    if (e <= end)
+      return;
+
+    // Note: the writer may be past end, when a take is cut on a bar. The
+    //       seek entry of a block starting at end may be an earlier take's,
+    //       decode the block before instead.
+    AdpcmState l, r;
+    if (end)
+    {
+      const uint32_t block = (end - 1) / BLOCK_FRAMES;
+      l = seek_[level][block].ch[0];
+      r = seek_[level][block].ch[1];
+      decodeFrames<Channels>(codes_[level], block * BLOCK_FRAMES, end - block * BLOCK_FRAMES, l, r, nullptr);
+    }
+    const AdpcmState wl = writers_[level][0];
+    const AdpcmState wr = writers_[level][1];
+    writers_[level][0] = l;
+    writers_[level][1] = r;
+    vec_clr_i16(scratch_, (e - end) * Channels);
+    encode<Channels>(level, end, scratch_, e - end);
+    writers_[level][0] = wl;
+    writers_[level][1] = wr;
+    markWritten(level, e);
+    invalidate();
+  }
+
+  // Decode frames [frame, frame + n) of codes, writing them to dst unless it
+  // is null.
+  template <uint32_t Channels>
+  static fast_inline void decodeFrames(const uint8_t *codes, uint32_t frame, uint32_t n, AdpcmState &l,
+                                       AdpcmState &r, sample_t *dst)
+  {
+    if (Channels == 1)
+    {
+      for (uint32_t i = frame; i < frame + n; ++i)
+      {
+        const int16_t x = adpcm_decode(l, (codes[i >> 1] >> ((i & 1) << 2)) & 15);
+        if (dst)
+          *dst++ = x;
+      }
+    }
+    else
+    {
+      for (uint32_t i = frame; i < frame + n; ++i)
+      {
+        const int16_t x0 = adpcm_decode(l, codes[i] & 15);
+        const int16_t x1 = adpcm_decode(r, codes[i] >> 4);
+        if (dst)
+        {
+          dst[0] = x0;
+          dst[1] = x1;
+          dst += 2;
+        }
+      }
+    }
+  }
+
+  // Make the window of r hold frames [lo, hi) of a level, hi - lo being at
+  // most WINDOW_FRAMES. Decodes only the frames it does not hold yet when
+  // moving forward, seeks otherwise.
+  template <uint32_t Channels>
+  inline const sample_t *fill(Reader &r, uint32_t level, int32_t lo, int32_t hi)
+  {
+    if (r.level != level || lo < r.first || lo > r.end)
+    {
+      r.level = level;
+      r.first = r.end = lo;
+      r.synced = false;
+    }
+    else if (hi - r.first > WINDOW_FRAMES)
+    {
+      // Keep the frames still needed at the start of the window
+      // Note: overlapping, so not vec_copy_i16()
+      const sample_t *src = r.window + (lo - r.first) * (int32_t)Channels;
+      const uint32_t len = (uint32_t)(r.end - lo) * Channels;
+      for (uint32_t i = 0; i < len; ++i)
+        r.window[i] = src[i];
+      r.first = lo;
+    }
+    decode<Channels>(r, hi);
+    return r.window;
+  }
+
+  template <uint32_t Channels>
+  inline void decode(Reader &r, int32_t hi)
+  {
+    enum
+    {
+      BLOCK_FRAMES = BLOCK_BYTES * 2 / Channels,
+    };
+    const int32_t capacity = (int32_t)levelFrames(r.level);
+    while (r.end < hi)
+    {
+      const int32_t f = r.end;
+      sample_t *dst = r.window + (f - r.first) * (int32_t)Channels;
+      int32_t frame = f;
+      if (frame < 0 || frame >= capacity)
+      {
+        if (!ring_)
+        {
+          // Silence before and after a one shot take
+          const int32_t n = ((f < 0 && hi > 0) ? 0 : hi) - f;
+          vec_clr_i16(dst, (uint32_t)n * Channels);
+          r.end += n;
+          r.synced = false;
+          continue;
+        }
+        frame += (frame < 0) ? capacity : -capacity;
+      }
+
+      const uint32_t offset = frame & (BLOCK_FRAMES - 1);
+      uint32_t n = ((uint32_t)(hi - f) < BLOCK_FRAMES - offset) ? (uint32_t)(hi - f) : BLOCK_FRAMES - offset;
+
+      // Silence past the clean area, not cleared yet when a ring take starts
+      // right after init and its readers wrap to the far end
+      const int32_t clean = (int32_t)(clean_bytes_[r.level] * 2 / Channels);
+      if (frame >= clean)
+      {
+        vec_clr_i16(dst, n * Channels);
+        r.end += (int32_t)n;
+        r.synced = false;
+        continue;
+      }
+      if ((uint32_t)(clean - frame) < n)
+        n = (uint32_t)(clean - frame);
+
+      const uint8_t *codes = codes_[r.level];
+      AdpcmState l = r.state[0];
+      AdpcmState rr = r.state[1];
+      if (!offset || !r.synced)
+      {
+        // Start from the seek table, then decode up to the frame
+        const AdpcmSeek &seek = seek_[r.level][frame / BLOCK_FRAMES];
+        l = seek.ch[0];
+        rr = seek.ch[1];
+        decodeFrames<Channels>(codes, frame - offset, offset, l, rr, nullptr);
+      }
+      decodeFrames<Channels>(codes, frame, n, l, rr, dst);
+      r.state[0] = l;
+      r.state[1] = rr;
+      r.synced = true;
+      r.end += n;
+    }
+  }
+
+  // Frames up to end of a level were just written, extend the clean area to
+  // GUARD_FRAMES past them.
+  // Note: a byte holding only the low nibble of a mono frame is written, its
+  //       high nibble was cleared by the encoder
+  inline void markWritten(uint32_t level, uint32_t end)
+  {
+    const uint32_t capacity = levelBytes(level);
+    const uint32_t clean = clean_bytes_[level];
+    end = (end * channels_ + 1) >> 1;
+    const uint32_t target = clipmaxu32(end + GUARD_FRAMES, capacity);
+    if (target <= clean)
+      return;
+    clear(level, (clean > end) ? clean : end, target);
+    clean_bytes_[level] = target;
+  }
+
+  // Zero the codes of bytes [begin, end) of a level and the seek entries of
+  // the blocks starting there, which decode to silence.
+  inline void clear(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    vec_clr_u8(codes_[level] + begin, end - begin);
+    const uint32_t b0 = (begin + BLOCK_BYTES - 1) / BLOCK_BYTES;
+    const uint32_t b1 = (end + BLOCK_BYTES - 1) / BLOCK_BYTES;
+    vec_clr_u8((uint8_t *)(seek_[level] + b0), (b1 - b0) * sizeof(AdpcmSeek));
+  }
+};
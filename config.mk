@@ -9,8 +9,16 @@ PROJECT_TYPE := genericfx
 # Sources
 #
 
+# CMSIS-DSP sources, only built for the target (see vector_ops.h)
+UCMSISSRC = $(CMSISDIR)/DSP_Lib/Source/SupportFunctions/arm_copy_f32.c \
+            $(CMSISDIR)/DSP_Lib/Source/SupportFunctions/arm_copy_q15.c \
+            $(CMSISDIR)/DSP_Lib/Source/SupportFunctions/arm_fill_q15.c \
+            $(CMSISDIR)/DSP_Lib/Source/SupportFunctions/arm_fill_q7.c \
+            $(CMSISDIR)/DSP_Lib/Source/BasicMathFunctions/arm_scale_f32.c \
+            $(CMSISDIR)/DSP_Lib/Source/BasicMathFunctions/arm_add_f32.c
+
 # C sources 
-UCSRC = header.c
+UCSRC = header.c $(UCMSISSRC)
 
 # C++ sources 
 UCXXSRC = unit.cc
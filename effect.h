@@ -49,6 +49,15 @@
 #include "utils/buffer_ops.h" // for buf_clr_f32()
 #include "utils/int_math.h"   // for clipminmaxi32()
 
+#include "adpcm.h"
+#include "event_queue.h"
+#include "fade.h"
+#include "interpolator.h"
+#include "mipmap.h"
+#include "sample_format.h"
+#include "sample_store.h"
+#include "smoother.h"
+
 class Effect
 {
 public:
@@ -58,44 +67,156 @@ public:
 
   enum
   {
-    BUFFER_LENGTH = 0x40000
+    PARAM1 = 0U,
+    LOOP,
+    DEPTH,
+    INTERP,
+    REC_MODE,
+    SLICES,
+    SYNC,
+    QUANT,
+    NUM_PARAMS
   };
 
   enum
   {
-    PARAM1 = 0U,
-    PARAM2,
-    DEPTH,
-    PARAM4,
-    NUM_PARAMS
+    MAX_SLICES = 16
+  };
+
+  enum
+  {
+    NUM_VOICES = 4, // slices playing at once, bounds the render cost
+    // Extra slots where a voice fades out while its slot plays on: a stolen
+    // voice, or the end of a LOOP_XFADE loop. One per voice, see
+    // allocateTail().
+    NUM_TAILS = NUM_VOICES,
+    FIRST_TAIL = NUM_VOICES,
+    NUM_VOICE_SLOTS = NUM_VOICES + NUM_TAILS,
+  };
+
+  // Recorded buffer and mip levels, see sample_store.h. Storage is the
+  // sample format voices read.
+#if defined(SAMPLE_STORAGE_ADPCM)
+  typedef AdpcmStore<NUM_VOICE_SLOTS> Store;
+#else
+  typedef LinearStore<SampleStorage> Store;
+#endif
+  typedef Store::format_t Storage;
+  typedef Storage::sample_t sample_t;
+
+  // Control change handed from the callbacks to the render thread
+  struct ControlEvent
+  {
+    enum
+    {
+      PARAM = 0U,
+      TOUCH,
+      TEMPO, // value: 16.16 fixed point BPM
+      TICK,  // value: 4ppqn tick counter
+      RESET, // stop every voice
+    };
+
+    uint32_t frame; // frame counter value the event is due at
+    uint8_t type;
+    uint8_t id;    // parameter index or touch id
+    uint8_t phase; // touch phase
+    int32_t value; // parameter value
+    uint32_t x;
+    uint32_t y;
+  };
+
+  enum
+  {
+    EVENT_QUEUE_SIZE = 64,
+    // Most frames played at once when the dry input must be kept aside
+    DRY_CHUNK_FRAMES = 64,
+  };
+
+  // flags_ bits
+  enum
+  {
+    FLAG_RESYNC_PARAMS = 1U << 0, // a parameter event was dropped
+    FLAG_RESET = 1U << 1,         // a reset event was dropped
+  };
+
+  enum
+  {
+    REC_ONESHOT = 0U, // record from touch until the buffer is full
+    REC_RING,         // record continuously, touch freezes what the buffer holds
+    REC_MONO,         // REC_ONESHOT and REC_RING keeping the mean of both
+    REC_MONO_RING,    // channels, twice as many frames
+    REC_OVERDUB,      // REC_ONESHOT, then loop the take and mix the input into it
+    NUM_REC_MODES,
+  };
+
+  enum
+  {
+    MIN_LOOP_FRAMES = 64, // shortest take REC_OVERDUB loops
+  };
+
+  // Note value each slice lasts in SYNC mode, at 1x speed
+  enum
+  {
+    SYNC_OFF = 0U,
+    SYNC_1_16,
+    SYNC_1_8,
+    SYNC_1_4,
+    SYNC_1_2,
+    SYNC_1_1,
+    NUM_SYNC_MODES,
+  };
+
+  enum
+  {
+    DEFAULT_TEMPO = 120U << 16, // used until the runtime sets one
+  };
+
+  enum
+  {
+    LOOP_OFF = 0U,
+    LOOP_ON,    // slices loop while touched, wrapping straight back
+    LOOP_XFADE, // same, crossfading the slice end into its start
+    NUM_LOOP_MODES,
+  };
+
+  enum
+  {
+    QUANT_OFF = 0U,
+    QUANT_1_16, // play mode touches fire on the next 4ppqn tick
+    QUANT_BAR,  // same, and one shot recording starts and stops on bars
+    NUM_QUANT_MODES,
+  };
+
+  enum
+  {
+    TICKS_PER_BAR = 16, // 4ppqn, 4/4
   };
 
   // Note: Make sure that default param values correspond to declarations in header.c
   struct Params
   {
     float param1{0.f};
-    float param2{0.f};
+    uint32_t loop{LOOP_OFF};
     float depth{0.f};
-    uint32_t param4{1};
+    uint32_t interp{INTERP_LINEAR}; // interpolation used by the play head
+    uint32_t rec_mode{REC_ONESHOT};
+    uint32_t slices{8}; // number of slices the take is split into along the X axis
+    uint32_t sync{SYNC_OFF};
+    uint32_t quant{QUANT_OFF};
 
     void reset()
     {
       param1 = 0.f;
-      param2 = 0.f;
+      loop = LOOP_OFF;
       depth = 0.f;
-      param4 = 1;
+      interp = INTERP_LINEAR;
+      rec_mode = REC_ONESHOT;
+      slices = 8;
+      sync = SYNC_OFF;
+      quant = QUANT_OFF;
     }
   };
 
-  enum
-  {
-    PARAM4_VALUE0 = 0,
-    PARAM4_VALUE1,
-    PARAM4_VALUE2,
-    PARAM4_VALUE3,
-    NUM_PARAM4_VALUES,
-  };
-
   /*===========================================================================*/
   /* Lifecycle Methods. */
   /*===========================================================================*/
@@ -127,20 +248,37 @@ public:
     // If SDRAM buffers are required they must be allocated here
     if (!desc->hooks.sdram_alloc)
       return k_unit_err_memory;
-    float *m = (float *)desc->hooks.sdram_alloc(BUFFER_LENGTH * sizeof(float));
+    // Claim the largest buffer the runtime grants, trying sizes down from
+    // Store::MAX_FRAMES in steps of Store::MIN_FRAMES.
+    // Note: one block holds every mip level
+    uint8_t *m = nullptr;
+    uint32_t frames = Store::MAX_FRAMES;
+    for (; frames >= Store::MIN_FRAMES; frames -= Store::MIN_FRAMES)
+    {
+      m = desc->hooks.sdram_alloc(Store::bytes(frames));
+      if (m)
+        break;
+    }
     if (!m)
       return k_unit_err_memory;
+    store_.init(m, frames);
 
-    // Make sure memory is cleared
-    buf_clr_f32(m, BUFFER_LENGTH);
-
-    allocated_buffer_ = m;
+    SincTable::init();
 
     // Cache the runtime descriptor for later use
     runtime_desc_ = *desc;
 
     // Make sure parameters are reset to default values
     params_.reset();
+    render_params_.reset();
+    s_wet.reset(0.f);
+    s_feedback.reset(0.f);
+    events_.clear();
+    s_frame_counter.store(0, std::memory_order_relaxed);
+    s_grid = 0;
+    s_grid_tick = 0;
+    flags_.store(0, std::memory_order_relaxed);
+    resetRecording();
 
     return k_unit_err_none;
   }
@@ -149,12 +287,18 @@ public:
   {
     // Note: buffers allocated via sdram_alloc are automatically freed after unit teardown
     // Note: cleanup and release resources if any
-    allocated_buffer_ = nullptr;
+    store_.teardown();
   }
 
   inline void Reset()
   {
     // Note: Reset effect state, excluding exposed parameter values.
+    //       The render thread stops the voices, see applyEvent()
+    ControlEvent event;
+    event.frame = s_frame_counter.load(std::memory_order_acquire);
+    event.type = ControlEvent::RESET;
+    if (!events_.push(event))
+      flags_.fetch_or(FLAG_RESET, std::memory_order_relaxed);
   }
 
   inline void Resume()
@@ -162,8 +306,8 @@ public:
     // Note: Effect will resume and exit suspend state. Usually means the synth
     // was selected and the render callback will be called again
 
-    // Note: If it is required to clear large memory buffers, consider setting a flag
-    //       and trigger an asynchronous progressive clear on the audio thread (Process() handler)
+    // Note: Buffers still being cleared after Init() keep being cleared by
+    //       clearProgressive() on the audio thread
   }
 
   inline void Suspend()
@@ -176,84 +320,64 @@ public:
   /* Other Public Methods. */
   /*===========================================================================*/
 
-  fast_inline void Process(const float *in, float *out, size_t frames)
+  // Frames rendered since Init(), wraps around.
+  inline uint32_t frameCounter() const
   {
-    const float *__restrict in_p = in;
-    float *__restrict out_p = out;
-    const float *out_e = out_p + (frames << 1); // assuming stereo output
+    return s_frame_counter.load(std::memory_order_acquire);
+  }
 
-    // Caching current parameter values. Consider interpolating sensitive parameters.
-    // const Params p = params_;
+  // Stereo frames of the buffer claimed by Init(), twice as many mono frames
+  inline uint32_t bufferFrames() const
+  {
+    return store_.frames();
+  }
 
-    if (params_.depth < 0)
-    {
+  // Frames of the take slices are cut from, 0 until one is recorded. Render
+  // thread state, only meaningful between Process() calls.
+  inline uint32_t takeFrames() const
+  {
+    return s_take_frames;
+  }
 
-      // record mode
+  // True until the progressive clear started by Init() is done.
+  inline bool isClearing() const
+  {
+    return store_.isClearing();
+  }
 
-      uint32_t writeidx = s_writeidx;
-      for (; out_p != out_e; in_p += 2, out_p += 2)
-      {
-        if (writeidx <= BUFFER_LENGTH - 1)
-        {
-          allocated_buffer_[writeidx + 0] = in_p[0];
-          allocated_buffer_[writeidx + 1] = in_p[1];
-          writeidx += 2;
-        }
-      }
-      s_writeidx = writeidx;
-    }
-    else
+  fast_inline void Process(const float *in, float *out, size_t frames)
+  {
+    // Note: continuous parameters ramp towards render_params_, see s_wet
+    if (store_.isClearing())
+      store_.clearProgressive();
+
+    // Split the block at every queued event falling inside it, so events take
+    // effect on the exact frame they are stamped with
+    const uint32_t block_start = s_frame_counter.load(std::memory_order_relaxed);
+    uint32_t done = 0;
+    while (done < frames)
     {
-
-      // play mode
-
-      uint32_t readidx = s_readidx;
-      for (; out_p != out_e; in_p += 2, out_p += 2)
-      {
-        if (readidx <= s_readidx_end && readidx <= BUFFER_LENGTH - 1)
-        {
-          out_p[0] = allocated_buffer_[readidx + 0];
-          out_p[1] = allocated_buffer_[readidx + 1];
-
-          // poor-mans' pitch shifter
-          readidx += 2 * speed;
-        }
-      }
-      s_readidx = readidx;
+      const uint32_t next = applyDueEvents(block_start + done, frames - done) + done;
+      renderSpan(in + (done << 1), out + (done << 1), next - done);
+      done = next;
     }
+
+    s_frame_counter.store(block_start + frames, std::memory_order_release);
   }
 
   inline void setParameter(uint8_t index, int32_t value)
   {
-    switch (index)
-    {
-    case PARAM1:
-      // 10bit 0-1023 parameter
-      value = clipminmaxi32(0, value, 1023);
-      params_.param1 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
-      break;
-
-    case PARAM2:
-      // 10bit 0-1023 parameter
-      value = clipminmaxi32(0, value, 1023);
-      params_.param2 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
-      break;
-
-    case DEPTH:
-      // Single digit base-10 fractional value, bipolar dry/wet
-      value = clipminmaxi32(-1000, value, 1000);
-      params_.depth = value / 1000.f; // -100.0 .. 100.0 -> -1.0 .. 1.0
-      break;
-
-    case PARAM4:
-      // strings type parameter, receiving index value
-      value = clipminmaxi32(PARAM4_VALUE0, value, NUM_PARAM4_VALUES - 1);
-      params_.param4 = value;
-      break;
-
-    default:
-      break;
-    }
+    // Note: params_ answers getParameterValue(), the render thread gets the
+    //       change through the event queue and applies it to render_params_
+    storeParameter(params_, index, value);
+
+    ControlEvent event;
+    event.frame = s_frame_counter.load(std::memory_order_acquire);
+    event.type = ControlEvent::PARAM;
+    event.id = index;
+    event.value = value;
+    if (!events_.push(event))
+      flags_.fetch_or(FLAG_RESYNC_PARAMS, std::memory_order_relaxed);
   }
 
   inline int32_t getParameterValue(uint8_t index) const
@@ -265,19 +389,33 @@ public:
       return param_f32_to_10bit(params_.param1);
       break;
 
-    case PARAM2:
-      // 10bit 0-1023 parameter
-      return param_f32_to_10bit(params_.param2);
-      break;
+    case LOOP:
+      // strings type parameter, return index value
+      return params_.loop;
 
     case DEPTH:
       // Single digit base-10 fractional value, bipolar dry/wet
       return (int32_t)(params_.depth * 1000);
       break;
 
-    case PARAM4:
+    case INTERP:
+      // strings type parameter, return index value
+      return params_.interp;
+
+    case REC_MODE:
+      // strings type parameter, return index value
+      return params_.rec_mode;
+
+    case SLICES:
+      return params_.slices;
+
+    case SYNC:
+      // strings type parameter, return index value
+      return params_.sync;
+
+    case QUANT:
       // strings type parameter, return index value
-      return params_.param4;
+      return params_.quant;
 
     default:
       break;
@@ -292,18 +430,63 @@ public:
     //       It can be assumed that caller will have copied or used the string
     //       before the next call to getParameterStrValue
 
-    static const char *param4_strings[NUM_PARAM4_VALUES] = {
-        "VAL 0",
-        "VAL 1",
-        "VAL 2",
-        "VAL 3",
+    static const char *loop_strings[NUM_LOOP_MODES] = {
+        "OFF",
+        "ON",
+        "XFADE",
+    };
+
+    static const char *interp_strings[NUM_INTERP_MODES] = {
+        "DROP",
+        "LINEAR",
+        "HERMITE",
+        "SINC",
+    };
+
+    static const char *rec_mode_strings[NUM_REC_MODES] = {
+        "ONESHOT",
+        "RING",
+        "MONO",
+        "MONORING",
+        "OVERDUB",
+    };
+
+    static const char *sync_strings[NUM_SYNC_MODES] = {
+        "OFF",
+        "1/16",
+        "1/8",
+        "1/4",
+        "1/2",
+        "1/1",
+    };
+
+    static const char *quant_strings[NUM_QUANT_MODES] = {
+        "OFF",
+        "1/16",
+        "BAR",
     };
 
     switch (index)
     {
-    case PARAM4:
-      if (value >= PARAM4_VALUE0 && value < NUM_PARAM4_VALUES)
-        return param4_strings[value];
+    case LOOP:
+      if (value >= LOOP_OFF && value < NUM_LOOP_MODES)
+        return loop_strings[value];
+      break;
+    case INTERP:
+      if (value >= INTERP_DROP && value < NUM_INTERP_MODES)
+        return interp_strings[value];
+      break;
+    case REC_MODE:
+      if (value >= REC_ONESHOT && value < NUM_REC_MODES)
+        return rec_mode_strings[value];
+      break;
+    case SYNC:
+      if (value >= SYNC_OFF && value < NUM_SYNC_MODES)
+        return sync_strings[value];
+      break;
+    case QUANT:
+      if (value >= QUANT_OFF && value < NUM_QUANT_MODES)
+        return quant_strings[value];
       break;
     default:
       break;
@@ -314,55 +497,47 @@ public:
 
   inline void setTempo(uint32_t tempo)
   {
-    // const float bpmf = (tempo >> 16) + (tempo & 0xFFFF) / static_cast<float>(0x10000);
-    (void)tempo;
+    ControlEvent event;
+    event.frame = s_frame_counter.load(std::memory_order_acquire);
+    event.type = ControlEvent::TEMPO;
+    event.value = (int32_t)tempo;
+    events_.push(event); // Note: a dropped tempo is caught up by the next one
   }
 
   inline void tempo4ppqnTick(uint32_t counter)
   {
-    (void)counter;
+    ControlEvent event;
+    event.frame = s_frame_counter.load(std::memory_order_acquire);
+    event.type = ControlEvent::TICK;
+    event.value = (int32_t)counter;
+    events_.push(event);
   }
 
   inline void touchEvent(uint8_t id, uint8_t phase, uint32_t x, uint32_t y)
+  {
+    // Note: the runtime gives no finer timing than the block, so the touch
+    //       lands on the first frame of the next block
+    touchEventAt(s_frame_counter.load(std::memory_order_acquire), id, phase, x, y);
+  }
+
+  // Post a touch due at a given frame counter value, see frameCounter().
+  // Frames must not decrease from one posted event to the next.
+  inline void touchEventAt(uint32_t frame, uint8_t id, uint8_t phase, uint32_t x, uint32_t y)
   {
     // Note: Touch x/y events are already mapped to specific parameters so there is usually there no need to set parameters from here.
     //       Audio source type effects, for instance, may require these events to trigger enveloppes and such.
 
-    (void)id;
-    (void)phase;
-    (void)x;
-    (void)y;
-
-    switch (phase)
-    {
-    // case k_unit_touch_phase_began:
-    //   break;
-    // case k_unit_touch_phase_moved:
-    //   break;
-    case k_unit_touch_phase_began:
-      if (params_.depth < 0)
-      {
-        s_writeidx = 0;
-      }
-      else
-      {
-        // TODO: lazily assume width is 1024 (2 ^ 10)
-        float quantized_x = (float)(x >> 7);
-        s_readidx = (uint32_t)(BUFFER_LENGTH * quantized_x / 8.0);
-        s_readidx_end = (uint32_t)(BUFFER_LENGTH * (quantized_x + 1.0) / 8.0);
-
-        // TODO: lazily assume height is 1024 (2 ^ 10). max: 1024 >> 8 = 4
-        float quantized_y = (float)(y >> 8);
-        speed = 1.0 + quantized_y;
-      }
-      break;
-    // case k_unit_touch_phase_stationary:
-    //   break;
-    // case k_unit_touch_phase_cancelled:
-    //   break;
-    default:
-      break;
-    }
+    // Note: handled by the render thread, see handleTouch(). A touch is
+    //       dropped if the queue is full.
+    ControlEvent event;
+    event.frame = frame;
+    event.type = ControlEvent::TOUCH;
+    event.id = id;
+    event.phase = phase;
+    event.value = 0;
+    event.x = x;
+    event.y = y;
+    events_.push(event);
   }
 
   /*===========================================================================*/
@@ -378,18 +553,1265 @@ private:
 
   unit_runtime_desc_t runtime_desc_;
 
+  // Parameters as last set by the runtime, and as seen by the render thread
   Params params_;
-
-  float *allocated_buffer_;
-  uint32_t s_writeidx = BUFFER_LENGTH;
-  uint32_t s_readidx = 0;
-  uint32_t s_readidx_end = 0;
-  float speed = 0.0;
+  Params render_params_;
+
+  // Voice gain of the dry/wet mix, following render_params_.depth in play mode
+  LinearSmoother s_wet;
+  // Share of the take kept per REC_OVERDUB pass, following
+  // -render_params_.depth while overdubbing
+  LinearSmoother s_feedback;
+
+  // Note: setParameter(), touchEvent(), setTempo(), tempo4ppqnTick() and
+  //       Reset() all push here, see EventQueue for why that is one producer
+  EventQueue<ControlEvent, EVENT_QUEUE_SIZE> events_;
+  std::atomic<uint32_t> s_frame_counter;
+
+  Store store_;
+  // REC_ONESHOT frame written next, levelFrames(0) when not recording
+  uint32_t s_writeidx = 0;
+
+  // REC_RING capture state. The ring is written at s_writeidx, wrapping
+  // around, and holds s_ring_frames valid frames.
+  bool s_ring_frozen = false;
+  uint32_t s_ring_frames = 0;
+
+  // The recorded take: s_take_frames frames starting at s_take_start in the
+  // buffer, possibly wrapping around its end. Play head phases are relative
+  // to s_take_start.
+  uint32_t s_take_start = 0;
+  uint32_t s_take_frames = 0;
+
+  // QUANT_BAR one shot recording: waiting for the bar to start on, or to
+  // stop on, and the length of the whole bars recorded so far, or 0.
+  // Recording stops once s_rec_end frames are written, levelFrames(0) unless
+  // it stops on a bar.
+  bool s_rec_armed = false;
+  bool s_rec_stop_armed = false;
+  uint32_t s_rec_bars = 0;
+  uint32_t s_loop_frames = 0;
+  uint32_t s_rec_end = 0;
+
+  // REC_OVERDUB: set while the input is mixed into the take, at frame
+  // s_overdub_pos of it
+  bool s_overdub = false;
+  uint32_t s_overdub_pos = 0;
+
+  // For each mip level, the frame its decimator writes next, and the number
+  // of frames of the level above not consumed by it yet.
+  uint32_t s_mip_writeidx[NUM_MIP_LEVELS] = {};
+  int32_t s_mip_pending[NUM_MIP_LEVELS] = {};
+
+  // Set while recording, until finalizeTake() completes the mip levels and
+  // slices the new take.
+  bool s_take_dirty = false;
+
+  // Dry input of the chunk being played when processing in place
+  float s_dry[DRY_CHUNK_FRAMES * 2];
+
+  // First frame of each slice of the take, plus the end of the last one
+  uint32_t s_slice_table[MAX_SLICES + 1] = {};
+
+  // Voice pool, one play head per voice. Position, playback ratio and end of
+  // the slice are 32.32 fixed point frames. A ratio is rounded to 2^-32 frame
+  // once, so the position never drifts: even over the longest take (2^23
+  // frames) it is off by less than 1/512 frame. A voice is free once its
+  // phase reaches its end. Voices are stolen oldest first, by s_voice_serial.
+  // s_voice_age counts the frames played, up to FADE_FRAMES, for the fade in.
+  uint64_t s_voice_phase[NUM_VOICE_SLOTS] = {};
+  uint64_t s_voice_phase_inc[NUM_VOICE_SLOTS] = {};
+  uint64_t s_voice_phase_end[NUM_VOICE_SLOTS] = {};
+  // A looping voice jumps from its end back to its loop start, until the
+  // touch that started it, s_voice_touch, ends. Released too close to its
+  // end to fade out, it stops looping at its next wrap instead, see
+  // releaseTouch(). A tail of a LOOP_ON voice jumps back the same way for
+  // the s_voice_wrap_frames frames of its fade left past the end.
+  uint64_t s_voice_loop_start[NUM_VOICE_SLOTS] = {};
+  bool s_voice_looping[NUM_VOICE_SLOTS] = {};
+  bool s_voice_release_at_wrap[NUM_VOICE_SLOTS] = {};
+  uint32_t s_voice_wrap_frames[NUM_VOICE_SLOTS] = {};
+  uint8_t s_voice_touch[NUM_VOICES] = {};
+  float s_voice_gain[NUM_VOICE_SLOTS] = {};
+  uint32_t s_voice_age[NUM_VOICE_SLOTS] = {};
+  uint32_t s_voice_serial[NUM_VOICES] = {};
+  uint32_t s_next_serial = 0;
+
+  // Tempo as 16.16 fixed point BPM, and the playback ratio of a slice in
+  // SYNC mode, see updateSync()
+  uint32_t s_tempo = DEFAULT_TEMPO;
+  uint64_t s_sync_phase_inc = 0;
+
+  // 1/16 grid as 16.16 fixed point frames of the frame counter: the last
+  // tick at or before the current frame and the tick period. Runs on its own
+  // at the tempo between 4ppqn callbacks, see lockGrid().
+  uint64_t s_grid = 0;
+  uint32_t s_grid_tick = 0; // 4ppqn counter value of the tick at s_grid
+  uint64_t s_tick_period = ((uint64_t)720000U << 32) / DEFAULT_TEMPO;
+
+  // Play mode touches waiting for the next grid tick in QUANT mode
+  uint32_t s_pending_x[NUM_VOICES] = {};
+  uint32_t s_pending_y[NUM_VOICES] = {};
+  uint8_t s_pending_touch[NUM_VOICES] = {};
+  bool s_pending_loop[NUM_VOICES] = {};
+  uint32_t s_num_pending = 0;
 
   /*===========================================================================*/
   /* Private Methods. */
   /*===========================================================================*/
 
+  // Clip and convert a parameter value into p
+  static inline void storeParameter(Params &p, uint8_t index, int32_t value)
+  {
+    switch (index)
+    {
+    case PARAM1:
+      // 10bit 0-1023 parameter
+      value = clipminmaxi32(0, value, 1023);
+      p.param1 = param_10bit_to_f32(value); // 0 .. 1023 -> 0.0 .. 1.0
+      break;
+
+    case LOOP:
+      // strings type parameter, receiving index value
+      value = clipminmaxi32(LOOP_OFF, value, NUM_LOOP_MODES - 1);
+      p.loop = value;
+      break;
+
+    case DEPTH:
+      // Single digit base-10 fractional value, bipolar dry/wet
+      value = clipminmaxi32(-1000, value, 1000);
+      p.depth = value / 1000.f; // -100.0 .. 100.0 -> -1.0 .. 1.0
+      break;
+
+    case INTERP:
+      // strings type parameter, receiving index value
+      value = clipminmaxi32(INTERP_DROP, value, NUM_INTERP_MODES - 1);
+      p.interp = value;
+      break;
+
+    case REC_MODE:
+      // strings type parameter, receiving index value
+      value = clipminmaxi32(REC_ONESHOT, value, NUM_REC_MODES - 1);
+      p.rec_mode = value;
+      break;
+
+    case SLICES:
+      value = clipminmaxi32(1, value, MAX_SLICES);
+      p.slices = value;
+      break;
+
+    case SYNC:
+      // strings type parameter, receiving index value
+      value = clipminmaxi32(SYNC_OFF, value, NUM_SYNC_MODES - 1);
+      p.sync = value;
+      break;
+
+    case QUANT:
+      // strings type parameter, receiving index value
+      value = clipminmaxi32(QUANT_OFF, value, NUM_QUANT_MODES - 1);
+      p.quant = value;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  // Render frames with the current state, no event may fall inside
+  fast_inline void renderSpan(const float *in, float *out, size_t frames)
+  {
+    const float *__restrict in_p = in;
+    float *__restrict out_p = out; // assuming stereo output
+
+    if (render_params_.depth < 0)
+    {
+
+      // record mode
+
+      s_wet.reset(0.f);
+      if (s_overdub)
+      {
+        // The take plays along, and writes out
+        overdub(in_p, out_p, frames);
+        return;
+      }
+
+      if (isRingMode(render_params_.rec_mode))
+      {
+        if (!s_ring_frozen)
+          recordRing(in_p, frames);
+      }
+      else
+      {
+        recordOneShot(in_p, frames);
+      }
+
+      // Nothing plays, monitor the input
+      // Note: the runtime may process in place
+      if (out_p != in_p)
+        vec_copy_f32(in_p, out_p, frames << 1);
+    }
+    else
+    {
+
+      // play mode
+
+      // Recording stopped
+      if (s_take_dirty)
+        finalizeTake();
+
+      // DEPTH crossfades from the dry input to the voices, ramping to a new
+      // value over the span
+      float wet_inc;
+      const float wet = s_wet.ramp(render_params_.depth, frames, wet_inc);
+      if ((wet < 1.f || wet_inc != 0.f) && in_p == out_p)
+      {
+        // Note: the runtime processes in place, keep the dry input of each
+        //       chunk before the voices overwrite it
+        for (uint32_t i = 0; i < frames; i += DRY_CHUNK_FRAMES)
+        {
+          const uint32_t n = clipmaxu32(frames - i, DRY_CHUNK_FRAMES);
+          vec_copy_f32(in_p + (i << 1), s_dry, n << 1);
+          playSpan(s_dry, out_p + (i << 1), n, wet + i * wet_inc, wet_inc);
+        }
+      }
+      else
+      {
+        playSpan(in_p, out_p, frames, wet, wet_inc);
+      }
+    }
+  }
+
+  // Play the voices into out at the wet gain, going by wet_inc per frame,
+  // mixed with in at 1 - wet.
+  fast_inline void playSpan(const float *__restrict in, float *__restrict out, uint32_t frames, float wet,
+                            float wet_inc)
+  {
+    // Note: idle most of the time, skip the voice loops altogether
+    if (voicesIdle())
+    {
+      if (wet_inc != 0.f)
+      {
+        buf_clr_f32(out, frames << 1);
+        vec_xfade_ramp_f32(in, out, wet, wet_inc, frames);
+      }
+      else if (wet < 1.f)
+      {
+        vec_scale_f32(in, 1.f - wet, out, frames << 1);
+      }
+      else
+      {
+        buf_clr_f32(out, frames << 1);
+      }
+      return;
+    }
+
+    if (store_.channels() == 1)
+      processPlay<1>(out, out + (frames << 1));
+    else
+      processPlay<2>(out, out + (frames << 1));
+    if (wet_inc != 0.f)
+      vec_xfade_ramp_f32(in, out, wet, wet_inc, frames);
+    else if (wet < 1.f)
+      vec_mix_f32(in, 1.f - wet, out, wet, frames << 1);
+  }
+
+  // Apply the queued events due at or before frame, return the number of
+  // frames, at most max_frames, until the next queued event is due.
+  inline uint32_t applyDueEvents(uint32_t frame, uint32_t max_frames)
+  {
+    ControlEvent event;
+    uint32_t until = max_frames;
+    while (events_.peek(event))
+    {
+      // Note: frame counter arithmetic, wraps around
+      const int32_t due = (int32_t)(event.frame - frame);
+      if (due > 0)
+      {
+        until = clipmaxu32(due, max_frames);
+        break;
+      }
+      events_.pop(event);
+      applyEvent(event);
+    }
+    const uint_fast32_t flags = flags_.load(std::memory_order_relaxed);
+    if (flags & FLAG_RESYNC_PARAMS)
+      resyncParameters();
+    if (flags & FLAG_RESET)
+    {
+      flags_.fetch_and(~(uint_fast32_t)FLAG_RESET, std::memory_order_relaxed);
+      stopVoices();
+    }
+
+    // Act on the grid tick if one is due, split on the next one if waiting
+    // for it
+    const int32_t tick_due = (int32_t)(nextTickFrame() - frame);
+    if (tick_due <= 0)
+    {
+      // Note: the grid may be several ticks behind after a tempo change
+      do
+      {
+        s_grid += s_tick_period;
+        ++s_grid_tick;
+      } while ((int32_t)(nextTickFrame() - frame) <= 0);
+      gridTick();
+    }
+    else if (s_num_pending || s_rec_armed || barRecording())
+    {
+      until = clipmaxu32(tick_due, until);
+    }
+    return until;
+  }
+
+  inline void applyEvent(const ControlEvent &event)
+  {
+    switch (event.type)
+    {
+    case ControlEvent::PARAM:
+      applyParameter(event.id, event.value);
+      break;
+    case ControlEvent::TOUCH:
+      handleTouch(event.id, event.phase, event.x, event.y);
+      break;
+    case ControlEvent::TEMPO:
+      if ((uint32_t)event.value != s_tempo && event.value > 0)
+      {
+        s_tempo = event.value;
+        updateTickPeriod();
+        updateSync();
+      }
+      break;
+    case ControlEvent::TICK:
+      lockGrid(event.frame, event.value);
+      break;
+    case ControlEvent::RESET:
+      stopVoices();
+      break;
+    default:
+      break;
+    }
+  }
+
+  inline void applyParameter(uint8_t index, int32_t value)
+  {
+    const Params prev = render_params_;
+    storeParameter(render_params_, index, value);
+
+    switch (index)
+    {
+    case REC_MODE:
+      // Note: the modes lay out the buffer differently, start over
+      if (render_params_.rec_mode != prev.rec_mode)
+        resetRecording();
+      break;
+    case SLICES:
+      if (render_params_.slices != prev.slices)
+        buildSliceTable();
+      break;
+    case SYNC:
+      if (render_params_.sync != prev.sync)
+        updateSync();
+      break;
+    case QUANT:
+      // Nothing left to wait for
+      if (render_params_.quant == QUANT_OFF)
+        firePendingTriggers();
+      break;
+    default:
+      break;
+    }
+  }
+
+  // A parameter event was dropped, catch up with every current value
+  inline void resyncParameters()
+  {
+    flags_.fetch_and(~(uint_fast32_t)FLAG_RESYNC_PARAMS, std::memory_order_relaxed);
+    for (uint8_t index = 0; index < NUM_PARAMS; ++index)
+      applyParameter(index, getParameterValue(index));
+  }
+
+  inline void handleTouch(uint8_t id, uint8_t phase, uint32_t x, uint32_t y)
+  {
+    switch (phase)
+    {
+    // case k_unit_touch_phase_moved:
+    //   break;
+    case k_unit_touch_phase_began:
+      if (render_params_.depth < 0)
+      {
+        if (isRingMode(render_params_.rec_mode))
+        {
+          // Freeze what has been captured so far, or resume capturing
+          s_ring_frozen = !s_ring_frozen;
+        }
+        else if (canOverdub())
+        {
+          // Close the loop, or start or stop overdubbing it
+          if (s_overdub)
+            finalizeTake();
+          else
+            startOverdub();
+        }
+        else if (render_params_.quant == QUANT_BAR)
+        {
+          // Start on the next bar, or stop on the next bar if recording
+          if (s_writeidx < levelFrames(0))
+          {
+            s_rec_stop_armed = true;
+          }
+          else if (!s_rec_armed)
+          {
+            resetRecording();
+            s_rec_armed = true;
+          }
+        }
+        else
+        {
+          resetRecording();
+          s_writeidx = 0;
+        }
+      }
+      else
+      {
+        if (render_params_.quant != QUANT_OFF)
+        {
+          // Wait for the next grid tick, see applyDueEvents()
+          const uint32_t i = (s_num_pending < NUM_VOICES) ? s_num_pending++ : NUM_VOICES - 1;
+          s_pending_x[i] = x;
+          s_pending_y[i] = y;
+          s_pending_touch[i] = id;
+          s_pending_loop[i] = render_params_.loop != LOOP_OFF;
+        }
+        else
+        {
+          triggerSlice(x, y, id, render_params_.loop != LOOP_OFF);
+        }
+      }
+      break;
+    case k_unit_touch_phase_ended:
+    case k_unit_touch_phase_cancelled:
+      releaseTouch(id);
+      break;
+    // case k_unit_touch_phase_stationary:
+    //   break;
+    default:
+      break;
+    }
+  }
+
+  static fast_inline uint64_t frame_to_phase(uint32_t frame)
+  {
+    return (uint64_t)frame << 32;
+  }
+
+  static fast_inline uint32_t phase_to_frame(uint64_t phase)
+  {
+    return (uint32_t)(phase >> 32);
+  }
+
+  fast_inline uint32_t levelFrames(uint32_t level) const
+  {
+    return store_.levelFrames(level);
+  }
+
+  static fast_inline bool isRingMode(uint32_t rec_mode)
+  {
+    return rec_mode == REC_RING || rec_mode == REC_MONO_RING;
+  }
+
+  // True when a REC_OVERDUB tap acts on the loop: recording a take not cut on
+  // a bar, or with a take recorded.
+  inline bool canOverdub() const
+  {
+    if (!Store::CAN_OVERDUB || render_params_.rec_mode != REC_OVERDUB || s_rec_armed)
+      return false;
+    if (s_writeidx < levelFrames(0) && render_params_.quant == QUANT_BAR)
+      return false;
+    return s_take_frames >= MIN_LOOP_FRAMES;
+  }
+
+  static fast_inline uint32_t recChannels(uint32_t rec_mode)
+  {
+    return (rec_mode == REC_MONO || rec_mode == REC_MONO_RING) ? 1 : 2;
+  }
+
+  inline void resetRecording()
+  {
+    // Note: first, the take layout and capacity follow the record mode
+    store_.reset(isRingMode(render_params_.rec_mode), recChannels(render_params_.rec_mode));
+    s_writeidx = levelFrames(0);
+    s_ring_frozen = false;
+    s_ring_frames = 0;
+    s_take_start = 0;
+    s_take_frames = 0;
+    s_rec_armed = s_rec_stop_armed = false;
+    s_loop_frames = 0;
+    s_rec_end = levelFrames(0);
+    s_overdub = false;
+    s_overdub_pos = 0;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      s_mip_writeidx[level] = 0;
+      s_mip_pending[level] = 0;
+    }
+    s_take_dirty = false;
+    buildSliceTable();
+
+    // The take the voices were playing is gone
+    stopVoices();
+  }
+
+  inline void stopVoices()
+  {
+    s_num_pending = 0;
+    for (uint32_t v = 0; v < NUM_VOICE_SLOTS; ++v)
+    {
+      s_voice_phase[v] = s_voice_phase_end[v] = 0;
+      s_voice_looping[v] = s_voice_release_at_wrap[v] = false;
+      s_voice_wrap_frames[v] = 0;
+    }
+  }
+
+  inline void recordOneShot(const float *in, size_t frames)
+  {
+    // Copy the frames that still fit in one go, anything past the end of
+    // the buffer, or past the bar recording stops on, is dropped.
+    const uint32_t end = s_rec_end;
+    const uint32_t writeidx = s_writeidx;
+    const uint32_t room = (writeidx < end) ? (end - writeidx) : 0;
+    const uint32_t n = (frames < room) ? frames : room;
+    if (!n)
+      return;
+
+    store_.write(in, writeidx, n);
+    s_writeidx = writeidx + n;
+    s_take_frames = s_writeidx;
+    if (s_writeidx == end)
+      s_writeidx = levelFrames(0);
+
+    // Extend the mip levels by what can be computed from the new frames
+    s_mip_pending[1] += n;
+    buildMips(false);
+    s_take_dirty = true;
+  }
+
+  inline void recordRing(const float *in, size_t frames)
+  {
+    // Copy in at most two runs, split where the ring wraps around
+    const uint32_t capacity = levelFrames(0);
+    uint32_t writeidx = s_writeidx;
+    if (writeidx >= capacity)
+      writeidx = 0;
+    uint32_t remaining = frames;
+    while (remaining)
+    {
+      const uint32_t room = capacity - writeidx;
+      const uint32_t n = (remaining < room) ? remaining : room;
+      store_.write(in, writeidx, n);
+      in += n << 1;
+      remaining -= n;
+      writeidx += n;
+      if (writeidx == capacity)
+        writeidx = 0;
+    }
+    s_writeidx = writeidx;
+
+    // The take is the whole history, oldest frame first
+    s_ring_frames = (s_ring_frames + frames < capacity) ? s_ring_frames + frames : capacity;
+    s_take_frames = s_ring_frames;
+    s_take_start = 0;
+    if (s_ring_frames == capacity)
+    {
+      // Note: stores that encode in blocks can only be read from the start of
+      //       one, the oldest frames up to the next are left out
+      const uint32_t align = store_.alignFrames();
+      const uint32_t skip = (align - writeidx % align) % align;
+      s_take_start = (writeidx + skip < capacity) ? writeidx + skip : writeidx + skip - capacity;
+      s_take_frames = capacity - skip;
+    }
+
+    s_mip_pending[1] += frames;
+    buildMips(false);
+    s_take_dirty = true;
+  }
+
+  // Start mixing the input into the take from s_overdub_pos, stopping the
+  // recording first if it runs.
+  inline void startOverdub()
+  {
+    if (s_writeidx < levelFrames(0))
+    {
+      s_writeidx = levelFrames(0);
+      s_overdub_pos = 0;
+    }
+    finalizeTake();
+
+    // The levels are computed again behind the overdub, see overdub()
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      s_mip_writeidx[level] = s_overdub_pos >> level;
+      s_mip_pending[level] = 0;
+    }
+    s_feedback.reset(-render_params_.depth);
+    s_overdub = true;
+  }
+
+  // Play the take looping from s_overdub_pos, mixing in into it. Touches every
+  // frame of the take once, see Store::overdub().
+  inline void overdub(const float *in, float *out, size_t frames)
+  {
+    // Note: the loop is the whole take, which starts at 0 in REC_ONESHOT layout
+    // Note: what the take keeps is written into it for good, ramp it like
+    //       the dry/wet gain so moving DEPTH leaves no steps in the take
+    float feedback_inc;
+    float feedback = s_feedback.ramp(-render_params_.depth, frames, feedback_inc);
+    const uint32_t loop = s_take_frames;
+    uint32_t pos = s_overdub_pos;
+    uint32_t remaining = frames;
+    while (remaining)
+    {
+      const uint32_t room = loop - pos;
+      const uint32_t n = (remaining < room) ? remaining : room;
+      store_.overdub(in, out, pos, n, feedback, feedback_inc);
+      feedback += n * feedback_inc;
+      in += n << 1;
+      out += n << 1;
+      remaining -= n;
+      pos += n;
+      if (pos == loop)
+        pos = 0;
+    }
+    s_overdub_pos = pos;
+
+    // Note: levels wrap at the loop end, the decimator taps crossing it read
+    //       the frames past the take
+    s_mip_pending[1] += frames;
+    buildMips(false, loop);
+    s_take_dirty = true;
+  }
+
+  // Compute the mip level frames whose source frames are available. Unless
+  // flushing, a frame also waits for the source frames its filter reads ahead.
+  // Levels wrap at their end, or at loop frames of level 0 if not 0.
+  // Flushing a one shot take also silences the frames past its end in each
+  // level, before the next level is computed from them.
+  inline void buildMips(bool flush, uint32_t loop = 0)
+  {
+    const int32_t lookahead = flush ? 0 : HalfbandDecimator::HALF_TAPS;
+    const bool end_take = flush && !isRingMode(render_params_.rec_mode);
+    for (uint32_t level = 1; level < NUM_MIP_LEVELS; ++level)
+    {
+      if (end_take)
+        store_.endTake(level - 1, s_take_frames >> (level - 1));
+
+      const int32_t pending = s_mip_pending[level];
+      if (pending <= lookahead)
+        continue;
+      uint32_t remaining = (uint32_t)(pending - lookahead + 1) >> 1;
+      s_mip_pending[level] -= remaining << 1;
+      if (level + 1 < NUM_MIP_LEVELS)
+        s_mip_pending[level + 1] += remaining;
+
+      const uint32_t capacity = loop ? (loop >> level) : levelFrames(level);
+      uint32_t writeidx = s_mip_writeidx[level];
+      if (writeidx >= capacity)
+        writeidx = 0;
+      while (remaining)
+      {
+        const uint32_t room = capacity - writeidx;
+        const uint32_t n = (remaining < room) ? remaining : room;
+        store_.decimate(level, writeidx, writeidx + n);
+        remaining -= n;
+        writeidx += n;
+        if (writeidx == capacity)
+          writeidx = 0;
+      }
+      s_mip_writeidx[level] = writeidx;
+    }
+    if (end_take)
+      store_.endTake(NUM_MIP_LEVELS - 1, s_take_frames >> (NUM_MIP_LEVELS - 1));
+  }
+
+  inline void finalizeTake()
+  {
+    // Note: recording may have run past the last bar, keep whole bars only.
+    //       It falls a few frames short if stopped before the bar it runs to.
+    if (s_loop_frames)
+      s_take_frames = clipmaxu32(s_loop_frames, s_take_frames);
+    // A one shot recording ends with its take, the next tap starts a new one.
+    // Note: resuming it would append to levels flushed against the silence
+    //       endTake() leaves past the end
+    if (!isRingMode(render_params_.rec_mode))
+    {
+      s_writeidx = levelFrames(0);
+      s_rec_stop_armed = false;
+    }
+    if (s_overdub)
+    {
+      s_overdub = false;
+      buildMips(true, s_take_frames);
+    }
+    buildMips(true);
+    buildSliceTable();
+    s_take_dirty = false;
+    // Voices may hold decoded frames of the previous take
+    store_.invalidate();
+  }
+
+  // Split the take into render_params_.slices equal slices, so the touch
+  // handler only needs a lookup.
+  inline void buildSliceTable()
+  {
+    const uint32_t slices = render_params_.slices;
+    for (uint32_t i = 0; i <= slices; ++i)
+      s_slice_table[i] = (uint32_t)((uint64_t)s_take_frames * i / slices);
+    updateSync();
+  }
+
+  // Ratio a slice is played at in SYNC mode so it lasts exactly the selected
+  // note value at the current tempo. Only runs when the tempo, the take or
+  // the slicing changes, so the render loop never divides.
+  inline void updateSync()
+  {
+    // Sixteenth notes per slice, indexed by SYNC mode
+    static const uint32_t sixteenths[NUM_SYNC_MODES] = {0, 1, 2, 4, 8, 16};
+    const uint32_t n = sixteenths[render_params_.sync];
+    if (!n)
+    {
+      s_sync_phase_inc = 0;
+      return;
+    }
+
+    // One sixteenth lasts 48000 * 60 / (4 * bpm) frames, with bpm = tempo / 2^16
+    //   ratio = slice_frames / (n * 720000 * 2^16 / tempo)
+    // and the 32.32 phase increment is ratio * 2^32. The slice length is kept
+    // as take_frames / slices so it stays exact.
+    // Note: a take holds at most 2 * Store::MAX_FRAMES frames (mono), 2^23
+    //       with ADPCM, and the tempo is below 2^31, so take_frames * tempo
+    //       fits in 64 bits but not once shifted by 16 more. The shift is
+    //       applied to the quotient and the remainder apart, den is below
+    //       2^28 so the remainder shifted stays below 2^44.
+    static_assert((uint64_t)Store::MAX_FRAMES * 2 <= (UINT64_MAX >> 32), "take_frames * tempo overflows");
+    static_assert((uint64_t)MAX_SLICES * 16 * 720000U < (1ULL << 28), "den overflows once shifted");
+    const uint64_t num = (uint64_t)s_take_frames * s_tempo;
+    const uint64_t den = (uint64_t)render_params_.slices * n * 720000U;
+    s_sync_phase_inc = ((num / den) << 16) + (((num % den) << 16) / den);
+  }
+
+  // Level to read from so the ratio it is played at is at most 1x,
+  // ceil(log2(ratio)), e.g. 3x reads the quarter rate level at 0.75x.
+  // Note: ratios above 2^(NUM_MIP_LEVELS - 1), only reached in SYNC mode,
+  //       still read the last level faster than 1x
+  static fast_inline uint32_t mipLevel(uint64_t phase_inc)
+  {
+    uint32_t level = 0;
+    while (level + 1 < NUM_MIP_LEVELS && phase_inc > frame_to_phase(1U << level))
+      ++level;
+    return level;
+  }
+
+  // Start a voice playing the slice under x, at the speed picked by y, and
+  // looping it until touch id ends if loop is set.
+  inline void triggerSlice(uint32_t x, uint32_t y, uint8_t id, bool loop)
+  {
+    if (s_take_dirty)
+      finalizeTake();
+
+    // TODO: lazily assume width is 1024 (2 ^ 10)
+    const uint32_t slice = clipmaxu32((x * render_params_.slices) >> 10, render_params_.slices - 1);
+    const uint32_t v = allocateVoice();
+    s_voice_phase[v] = frame_to_phase(s_slice_table[slice]);
+    s_voice_phase_end[v] = frame_to_phase(s_slice_table[slice + 1]);
+    s_voice_loop_start[v] = s_voice_phase[v];
+    s_voice_looping[v] = loop && s_voice_phase_end[v] > s_voice_phase[v];
+    s_voice_release_at_wrap[v] = false;
+    s_voice_touch[v] = id;
+
+    // TODO: lazily assume height is 1024 (2 ^ 10). max: 1024 >> 8 = 4
+    const uint32_t speed = 1 + (y >> 8);
+    if (render_params_.sync != SYNC_OFF)
+      s_voice_phase_inc[v] = s_sync_phase_inc * speed;
+    else
+      s_voice_phase_inc[v] = ratio_to_phase_inc(speed, 1);
+    s_voice_gain[v] = 1.f;
+    s_voice_age[v] = 0;
+  }
+
+  inline void gridTick()
+  {
+    firePendingTriggers();
+    if (s_grid_tick % TICKS_PER_BAR == 0)
+      bar();
+  }
+
+  // True while one shot recording started on a bar is running.
+  inline bool barRecording() const
+  {
+    return s_writeidx < levelFrames(0) && render_params_.quant == QUANT_BAR;
+  }
+
+  inline void bar()
+  {
+    if (render_params_.depth >= 0 || isRingMode(render_params_.rec_mode) || render_params_.quant != QUANT_BAR)
+    {
+      s_rec_armed = s_rec_stop_armed = false;
+      return;
+    }
+
+    if (s_rec_armed)
+    {
+      s_rec_armed = false;
+      s_rec_bars = 0;
+      s_writeidx = 0;
+      return;
+    }
+    if (s_writeidx < levelFrames(0))
+    {
+      // Whole bars recorded so far, the take is cut there when it ends.
+      // Note: the grid follows the tick callbacks' jitter a little, the
+      //       length is computed from the tempo so it is exact
+      ++s_rec_bars;
+      const uint64_t frames = (s_rec_bars * TICKS_PER_BAR * s_tick_period + (1U << 15)) >> 16;
+      s_loop_frames = clipmaxu32((uint32_t)frames, levelFrames(0));
+      if (s_rec_stop_armed)
+      {
+        // Note: the grid may be a few frames ahead of what was recorded,
+        //       which then runs on up to the computed length, or behind
+        //       it, which cuts the take there right away
+        s_rec_stop_armed = false;
+        s_rec_end = s_loop_frames;
+        if (s_writeidx >= s_rec_end)
+        {
+          s_writeidx = levelFrames(0);
+          s_take_frames = s_rec_end;
+        }
+      }
+    }
+  }
+
+  inline void firePendingTriggers()
+  {
+    for (uint32_t i = 0; i < s_num_pending; ++i)
+      triggerSlice(s_pending_x[i], s_pending_y[i], s_pending_touch[i], s_pending_loop[i]);
+    s_num_pending = 0;
+  }
+
+  // Touch id ended, its voices play to the end of their slice and stop.
+  inline void releaseTouch(uint8_t id)
+  {
+    for (uint32_t i = 0; i < s_num_pending; ++i)
+      if (s_pending_touch[i] == id)
+        s_pending_loop[i] = false;
+    for (uint32_t v = 0; v < NUM_VOICES; ++v)
+    {
+      if (s_voice_touch[v] != id || !s_voice_looping[v])
+        continue;
+      // Note: the fade out takes FADE_FRAMES frames, a loop with fewer left
+      //       plays to the end of its next pass, unless already fading out
+      const uint32_t left = framesUntil(s_voice_phase[v], s_voice_phase_end[v], s_voice_phase_inc[v]);
+      if (left > FADE_FRAMES || fadesToEnd(v))
+        s_voice_looping[v] = false;
+      else
+        s_voice_release_at_wrap[v] = true;
+    }
+  }
+
+  // Frame counter value of the next 1/16 grid tick.
+  fast_inline uint32_t nextTickFrame() const
+  {
+    return (uint32_t)((s_grid + s_tick_period) >> 16);
+  }
+
+  // Frames per 4ppqn tick: 48000 * 60 / (4 * bpm), bpm = tempo / 2^16
+  inline void updateTickPeriod()
+  {
+    s_tick_period = ((uint64_t)720000U << 32) / s_tempo;
+  }
+
+  // Pull the grid towards a tick that arrived at frame. Tick callbacks are
+  // only block accurate, so the grid keeps running at the tempo and the
+  // arrival times only nudge it, which averages their jitter out. A tick far
+  // off the grid, e.g. when the transport starts, snaps it instead.
+  inline void lockGrid(uint32_t frame, uint32_t counter)
+  {
+    const int32_t period = (int32_t)(s_tick_period >> 16);
+    int32_t error = (int32_t)(frame - (uint32_t)(s_grid >> 16));
+    uint32_t tick = counter;
+    if (error > period / 2)
+    {
+      // Closer to the next grid tick, which is the one at counter
+      error -= period;
+      --tick;
+    }
+    else if (error < -period / 2)
+    {
+      error += period;
+      ++tick;
+    }
+    if (error > period / 4 || error < -period / 4)
+    {
+      s_grid = (uint64_t)frame << 16;
+      tick = counter;
+    }
+    else
+    {
+      s_grid += (int64_t)error * 8192; // 1/8 of the error, in 16.16 frames
+    }
+    s_grid_tick = tick;
+  }
+
+  // Pick a free voice, or steal the oldest one.
+  inline uint32_t allocateVoice()
+  {
+    uint32_t oldest = 0;
+    for (uint32_t v = 0; v < NUM_VOICES; ++v)
+    {
+      if (s_voice_phase[v] >= s_voice_phase_end[v])
+      {
+        s_voice_serial[v] = s_next_serial++;
+        return v;
+      }
+      if ((int32_t)(s_voice_serial[v] - s_voice_serial[oldest]) < 0)
+        oldest = v;
+    }
+
+    // Crossfade: the stolen voice carries on in a tail slot, ending
+    // FADE_FRAMES from now so it fades out while the new slice fades in.
+    // Past the end of a looping slice the tail plays what the voice would
+    // have: on past the end in LOOP_XFADE, up to the take end as in
+    // wrapVoice(), or from the loop start in LOOP_ON.
+    const uint64_t phase = s_voice_phase[oldest];
+    const uint64_t phase_inc = s_voice_phase_inc[oldest];
+    const uint64_t end = s_voice_phase_end[oldest];
+    const uint64_t fade_end = phase + FADE_FRAMES * phase_inc;
+    uint64_t tail_end = (fade_end < end) ? fade_end : end;
+    uint32_t wrap_frames = 0;
+    if (s_voice_looping[oldest] && fade_end > end)
+    {
+      const uint64_t take_end = frame_to_phase(s_take_frames);
+      if (fadesAtWrap(oldest))
+        tail_end = (fade_end < take_end) ? fade_end : take_end;
+      else
+        wrap_frames = FADE_FRAMES - framesUntil(phase, end, phase_inc);
+    }
+    startTail(oldest, tail_end, s_voice_age[oldest], wrap_frames);
+
+    s_voice_serial[oldest] = s_next_serial++;
+    return oldest;
+  }
+
+  // Tail slot for voice v to fade out in: its own if free, else another free
+  // one, else the one with the fewest frames left, which is cut. Each voice
+  // starts a tail at most once per 2 * FADE_FRAMES frames when looping, so
+  // only a burst of steals runs out of them.
+  inline uint32_t allocateTail(uint32_t v)
+  {
+    const uint32_t own = FIRST_TAIL + v;
+    if (s_voice_phase[own] >= s_voice_phase_end[own])
+      return own;
+    uint32_t best = own;
+    uint32_t best_left = tailFramesLeft(own);
+    for (uint32_t t = FIRST_TAIL; t < NUM_VOICE_SLOTS; ++t)
+    {
+      const uint32_t left = tailFramesLeft(t);
+      if (left < best_left)
+      {
+        best = t;
+        best_left = left;
+      }
+    }
+    return best;
+  }
+
+  // Frames tail slot t plays before it is done.
+  inline uint32_t tailFramesLeft(uint32_t t) const
+  {
+    return framesUntil(s_voice_phase[t], s_voice_phase_end[t], s_voice_phase_inc[t]) + s_voice_wrap_frames[t];
+  }
+
+  // Play on voice v from its position in a tail slot, up to end and then
+  // wrap_frames frames from its loop start, starting its fade at age.
+  // Returns the slot.
+  inline uint32_t startTail(uint32_t v, uint64_t end, uint32_t age, uint32_t wrap_frames)
+  {
+    const uint32_t t = allocateTail(v);
+    s_voice_phase[t] = s_voice_phase[v];
+    s_voice_phase_inc[t] = s_voice_phase_inc[v];
+    s_voice_phase_end[t] = end;
+    s_voice_loop_start[t] = s_voice_loop_start[v];
+    s_voice_gain[t] = s_voice_gain[v];
+    s_voice_age[t] = age;
+    s_voice_looping[t] = false;
+    s_voice_wrap_frames[t] = wrap_frames;
+    return t;
+  }
+
+  // True when no voice has frames left to play.
+  inline bool voicesIdle() const
+  {
+    for (uint32_t v = 0; v < NUM_VOICE_SLOTS; ++v)
+      if (s_voice_phase[v] < s_voice_phase_end[v] && s_voice_phase_inc[v])
+        return false;
+    return true;
+  }
+
+  // Play the voices from a take of Channels channels.
+  template <uint32_t Channels>
+  fast_inline void processPlay(float *__restrict out_p, const float *out_e)
+  {
+    switch (render_params_.interp)
+    {
+    case INTERP_DROP:
+      processPlay<INTERP_DROP, Channels>(out_p, out_e);
+      break;
+    case INTERP_LINEAR:
+      processPlay<INTERP_LINEAR, Channels>(out_p, out_e);
+      break;
+    case INTERP_HERMITE:
+      processPlay<INTERP_HERMITE, Channels>(out_p, out_e);
+      break;
+    case INTERP_SINC:
+      processPlay<INTERP_SINC, Channels>(out_p, out_e);
+      break;
+    default:
+      break;
+    }
+  }
+
+  template <uint32_t Interp, uint32_t Channels>
+  fast_inline void processPlay(float *__restrict out_p, const float *out_e)
+  {
+    const uint32_t frames = (out_e - out_p) >> 1;
+
+    // The first voice playing writes the output, the others mix into it.
+    // Note: the tail slots go first, a loop wrapping in a voice renders its
+    //       new tail at the wrap frame, see playVoice()
+    uint32_t i = 0;
+    uint32_t written = 0;
+    for (; i < NUM_VOICE_SLOTS && !written; ++i)
+      written = playVoice<Interp, Channels, false>(slotOrder(i), out_p, frames);
+    if (written < frames)
+      buf_clr_f32(out_p + (written << 1), (frames - written) << 1);
+    for (; i < NUM_VOICE_SLOTS; ++i)
+      playVoice<Interp, Channels, true>(slotOrder(i), out_p, frames);
+  }
+
+  // Voice slot rendered i-th: the tail slots, then the voices.
+  static fast_inline uint32_t slotOrder(uint32_t i)
+  {
+    return (i + FIRST_TAIL) % NUM_VOICE_SLOTS;
+  }
+
+  // Render voice v into out_p, overwriting or mixing into it. Returns the
+  // number of frames rendered, less than frames if the slice ends. A looping
+  // voice wraps back to its loop start instead, the render is split there.
+  template <uint32_t Interp, uint32_t Channels, bool Mix>
+  fast_inline uint32_t playVoice(uint32_t v, float *__restrict out_p, uint32_t frames)
+  {
+    uint32_t played = playSegment<Interp, Channels, Mix>(v, out_p, frames);
+    // Note: wrap as soon as the end is reached, so a looping voice is never
+    //       seen as free or idle
+    while ((s_voice_looping[v] || s_voice_wrap_frames[v]) && s_voice_phase[v] >= s_voice_phase_end[v])
+    {
+      const uint32_t tail = s_voice_looping[v] ? wrapVoice(v) : wrapTail(v);
+      const uint32_t n = playSegment<Interp, Channels, Mix>(v, out_p + (played << 1), frames - played);
+      if (tail < NUM_VOICE_SLOTS)
+        playSegment<Interp, Channels, true>(tail, out_p + (played << 1), n);
+      played += n;
+    }
+    return played;
+  }
+
+  // True when looping voice v fades at its wraps, in LOOP_XFADE.
+  // Note: a loop too short to hold both fades wraps straight back
+  fast_inline bool fadesAtWrap(uint32_t v) const
+  {
+    return render_params_.loop == LOOP_XFADE &&
+           s_voice_phase_end[v] - s_voice_loop_start[v] >= 2 * FADE_FRAMES * s_voice_phase_inc[v];
+  }
+
+  // True when looping voice v fades out to the end of its slice. A slice
+  // ending the take has no frames past its end to crossfade from, in
+  // LOOP_XFADE it fades out there and in again from its start.
+  fast_inline bool fadesToEnd(uint32_t v) const
+  {
+    return s_voice_phase_end[v] >= frame_to_phase(s_take_frames) && fadesAtWrap(v);
+  }
+
+  // Jump looping voice v from the end of its slice back to its loop start.
+  // In LOOP_XFADE a tail slot plays on past the end and fades out while v
+  // fades in again, returns that slot, or NUM_VOICE_SLOTS.
+  inline uint32_t wrapVoice(uint32_t v)
+  {
+    const uint64_t phase = s_voice_phase[v];
+    const uint64_t phase_inc = s_voice_phase_inc[v];
+    const uint64_t end = s_voice_phase_end[v];
+    const uint64_t len = end - s_voice_loop_start[v];
+
+    uint32_t tail = NUM_VOICE_SLOTS;
+    if (fadesAtWrap(v))
+    {
+      const uint64_t tail_end = phase + FADE_FRAMES * phase_inc;
+      const uint64_t take_end = frame_to_phase(s_take_frames);
+      if (end < take_end)
+        tail = startTail(v, (tail_end < take_end) ? tail_end : take_end, FADE_FRAMES, 0);
+      s_voice_age[v] = 0;
+    }
+
+    // Note: the play head may overshoot the end by more than the loop at
+    //       high ratios
+    s_voice_phase[v] = s_voice_loop_start[v] + (phase - end) % len;
+    if (s_voice_release_at_wrap[v])
+      s_voice_looping[v] = s_voice_release_at_wrap[v] = false;
+    return tail;
+  }
+
+  // Jump tail slot t from the end of its slice back to its loop start, to
+  // play the rest of its fade there. Returns NUM_VOICE_SLOTS, no tail starts.
+  inline uint32_t wrapTail(uint32_t t)
+  {
+    const uint64_t phase_inc = s_voice_phase_inc[t];
+    const uint64_t end = s_voice_phase_end[t];
+    const uint64_t phase = s_voice_loop_start[t] + (s_voice_phase[t] - end) % (end - s_voice_loop_start[t]);
+    const uint32_t pass = framesUntil(phase, end, phase_inc);
+    const uint32_t left = s_voice_wrap_frames[t];
+    s_voice_phase[t] = phase;
+    if (left < pass)
+      s_voice_phase_end[t] = phase + left * phase_inc;
+    // Note: a loop shorter than the fade wraps again
+    s_voice_wrap_frames[t] = (left > pass) ? left - pass : 0;
+    return NUM_VOICE_SLOTS;
+  }
+
+  // Render voice v into out_p up to the end of its slice, overwriting or
+  // mixing into it. Returns the number of frames rendered.
+  template <uint32_t Interp, uint32_t Channels, bool Mix>
+  fast_inline uint32_t playSegment(uint32_t v, float *__restrict out_p, uint32_t frames)
+  {
+    const uint64_t phase_inc_full = s_voice_phase_inc[v];
+    const uint32_t remaining = framesUntil(s_voice_phase[v], s_voice_phase_end[v], phase_inc_full);
+    const uint32_t played = (remaining < frames) ? remaining : frames;
+    if (!played)
+      return 0;
+
+    // Map the take relative phase into the buffer, and play in at most two
+    // runs split where the buffer wraps around.
+    const uint64_t capacity = frame_to_phase(levelFrames(0));
+    uint64_t pos = s_voice_phase[v] + frame_to_phase(s_take_start);
+    if (pos >= capacity)
+      pos -= capacity;
+    s_voice_phase[v] += played * phase_inc_full;
+
+    // Run the loop in the coordinates of the selected level. The full
+    // resolution position is advanced by the frames played, so the truncated
+    // level increment never drifts from it.
+    const uint32_t level = mipLevel(phase_inc_full);
+    const uint64_t phase_inc = phase_inc_full >> level;
+    const float gain = s_voice_gain[v];
+
+    // Fade position: frames since the voice started and frames left in its
+    // slice, or no end while looping. The loop is split into runs at a
+    // constant gain, or where the fade gain walks the table at a fixed
+    // stride, so fading costs a multiply per frame and no branch.
+    uint32_t age = s_voice_age[v];
+    uint32_t to_end = (s_voice_looping[v] && !fadesToEnd(v)) ? UINT32_MAX : remaining + s_voice_wrap_frames[v];
+    s_voice_age[v] = clipmaxu32(age + played, FADE_FRAMES);
+
+    uint32_t left = played;
+    while (left)
+    {
+      const uint32_t until_wrap = framesUntil(pos, capacity, phase_inc_full);
+      const float *fade;
+      int32_t stride;
+      const uint32_t until_fade = fadeRun(age, to_end, fade, stride);
+      uint32_t n = (left < until_wrap) ? left : until_wrap;
+      n = (n < until_fade) ? n : until_fade;
+      uint64_t phase = pos >> level;
+      const sample_t *buf = store_.template read<Channels>(v, level, phase, phase_inc, n);
+      if (stride)
+        renderRun<Interp, Channels, Mix, true>(buf, phase, phase_inc, gain, fade, stride, out_p, n);
+      else
+        renderRun<Interp, Channels, Mix, false>(buf, phase, phase_inc, gain, fade, 0, out_p, n);
+      out_p += n << 1;
+      left -= n;
+      age += n;
+      to_end -= n;
+      pos += n * phase_inc_full;
+      if (pos >= capacity)
+        pos -= capacity;
+    }
+    return played;
+  }
+
+  // Render n frames of a voice, at a constant gain or fading.
+  template <uint32_t Interp, uint32_t Channels, bool Mix, bool Fading>
+  static fast_inline void renderRun(const sample_t *buf, uint64_t phase, uint64_t phase_inc, float gain,
+                                    const float *fade, int32_t stride, float *__restrict out_p, uint32_t n)
+  {
+    for (uint32_t i = 0; i < n; ++i, out_p += 2)
+    {
+      float frame[2];
+      Interpolator<Interp, Storage, Channels>::render(buf, phase, frame);
+      float g = gain;
+      if (Fading)
+      {
+        g *= *fade;
+        fade += stride;
+      }
+      if (Mix)
+      {
+        out_p[0] += g * frame[0];
+        out_p[1] += g * frame[1];
+      }
+      else
+      {
+        out_p[0] = g * frame[0];
+        out_p[1] = g * frame[1];
+      }
+      phase += phase_inc;
+    }
+  }
+
+  // Fade gains of a voice age frames old with to_end frames left to play,
+  // fade_table()[min(age, to_end - 1, FADE_FRAMES)]. Points fade at the
+  // first gain and returns for how many frames it can be walked at stride.
+  static fast_inline uint32_t fadeRun(uint32_t age, uint32_t to_end, const float *&fade, int32_t &stride)
+  {
+    const float *t = fade_table();
+    if (age < FADE_FRAMES && age < to_end - 1)
+    {
+      // Fading in, until fully in or meeting the fade out
+      fade = t + age;
+      stride = 1;
+      const uint32_t n = (to_end - 1 - age) / 2 + 1;
+      return (n < FADE_FRAMES - age) ? n : FADE_FRAMES - age;
+    }
+    if (to_end - 1 >= FADE_FRAMES)
+    {
+      fade = t + FADE_FRAMES;
+      stride = 0;
+      return to_end - FADE_FRAMES;
+    }
+    fade = t + (to_end - 1);
+    stride = -1;
+    return to_end;
+  }
+
+  // Number of frames the play head can render before reaching end.
+  static inline uint32_t framesUntil(uint64_t phase, uint64_t end, uint64_t phase_inc)
+  {
+    if (phase >= end || !phase_inc)
+      return 0;
+    const uint64_t n = (end - phase + phase_inc - 1) / phase_inc;
+    return (n > UINT32_MAX) ? UINT32_MAX : (uint32_t)n;
+  }
+
+  // Phase increment for a playback ratio of num / den.
+  static inline uint64_t ratio_to_phase_inc(uint32_t num, uint32_t den)
+  {
+    return ((uint64_t)num << 32) / den;
+  }
+
   /*===========================================================================*/
   /* Constants. */
   /*===========================================================================*/
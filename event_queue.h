@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+ *  File: event_queue.h
+ *
+ *  Bounded lock-free single-producer/single-consumer queue, used to hand
+ *  control events from the unit callbacks to the render thread.
+ *
+ *  The producer is the runtime's control context. It calls every callback
+ *  that pushes (parameter, touch, tempo, 4ppqn tick and reset) one at a
+ *  time, never concurrently with one another, so they are a single
+ *  producer between them. A callback that could run from another context,
+ *  e.g. an interrupt, needs its own queue.
+ *
+ */
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T, uint32_t Capacity>
+class EventQueue
+{
+  static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+
+public:
+  EventQueue(void) : head_(0), tail_(0) {}
+
+  // Producer side. Returns false, dropping the event, when the queue is full.
+  inline bool push(const T &event)
+  {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == Capacity)
+      return false;
+    buffer_[tail & (Capacity - 1)] = event;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the queue is empty.
+  inline bool pop(T &event)
+  {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    event = buffer_[head & (Capacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Reads the oldest event without removing it.
+  inline bool peek(T &event) const
+  {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    event = buffer_[head & (Capacity - 1)];
+    return true;
+  }
+
+  // Note: only safe while neither side is running, e.g. from Init()
+  inline void clear()
+  {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  T buffer_[Capacity];
+};
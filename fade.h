@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ *  File: fade.h
+ *
+ *  Declicking fades applied where a voice starts, ends or is taken over.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+
+enum
+{
+  FADE_FRAMES = 64, // ~1.3 ms at 48 kHz
+};
+
+// Raised cosine rising from 0 at index 0 to 1 at FADE_FRAMES, precomputed as
+// sin^2(pi / 2 * i / FADE_FRAMES). Walk it backwards to fade out.
+fast_inline const float *fade_table()
+{
+  static const float t[FADE_FRAMES + 1] = {
+      0.000000000e+00f, 6.022718974e-04f, 2.407636664e-03f, 5.411745018e-03f,
+      9.607359798e-03f, 1.498437340e-02f, 2.152983213e-02f, 2.922796741e-02f,
+      3.806023374e-02f, 4.800535344e-02f, 5.903936783e-02f, 7.113569500e-02f,
+      8.426519385e-02f, 9.839623426e-02f, 1.134947733e-01f, 1.295244373e-01f,
+      1.464466094e-01f, 1.642205226e-01f, 1.828033579e-01f, 2.021503478e-01f,
+      2.222148835e-01f, 2.429486279e-01f, 2.643016316e-01f, 2.862224533e-01f,
+      3.086582838e-01f, 3.315550733e-01f, 3.548576614e-01f, 3.785099100e-01f,
+      4.024548390e-01f, 4.266347628e-01f, 4.509914298e-01f, 4.754661628e-01f,
+      5.000000000e-01f, 5.245338372e-01f, 5.490085702e-01f, 5.733652372e-01f,
+      5.975451610e-01f, 6.214900900e-01f, 6.451423386e-01f, 6.684449267e-01f,
+      6.913417162e-01f, 7.137775467e-01f, 7.356983684e-01f, 7.570513721e-01f,
+      7.777851165e-01f, 7.978496522e-01f, 8.171966421e-01f, 8.357794774e-01f,
+      8.535533906e-01f, 8.704755627e-01f, 8.865052267e-01f, 9.016037657e-01f,
+      9.157348062e-01f, 9.288643050e-01f, 9.409606322e-01f, 9.519946466e-01f,
+      9.619397663e-01f, 9.707720326e-01f, 9.784701679e-01f, 9.850156266e-01f,
+      9.903926402e-01f, 9.945882550e-01f, 9.975923633e-01f, 9.993977281e-01f,
+      1.000000000e+00f,
+  };
+  return t;
+}
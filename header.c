@@ -51,7 +51,7 @@ const __unit_header genericfx_unit_header_t unit_header = {
     .unit_id = 0x0U,                                          // ID for this unit. Scoped within the context of a given dev_id.
     .version = 0x00010000U,                                   // This unit's version: major.minor.patch (major<<16 minor<<8 patch).
     .name = "sampler",                                        // Name for this unit, will be displayed on device
-    .num_params = 4,                                          // Number of valid parameter descriptors. (max. 8)
+    .num_params = 8,                                          // Number of valid parameter descriptors. (max. 8)
     
     .params = {
       // Format: min, max, center, default, type, frac. bits, frac. mode, <reserved>, name
@@ -60,18 +60,28 @@ const __unit_header genericfx_unit_header_t unit_header = {
 
       // Examples of simple numeric parameters
       {0, 1023, 0, 0, k_unit_param_type_none, 0, 0, 0, {"PARAM1"}},
-      {0, 1023, 0, 0, k_unit_param_type_none, 0, 0, 0, {"PARAM2"}},
+
+      // Slice looping while touched: OFF, ON, XFADE (crossfaded seam)
+      {0, 2, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"LOOP"}},
       
       // Example of a parameter with negative values and one fractional digit (base 10), using the drywet display type 
       {-1000, 1000, 0, 0, k_unit_param_type_drywet, 1, 1, 0, {"DEPTH"}},
 
-      // Example of a strings type parameter
-      {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"PARAM4"}},
-      
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}},
-      {0, 0, 0, 0, k_unit_param_type_none, 0, 0, 0, {""}}},
+      // Interpolation used when playing back: DROP, LINEAR, HERMITE, SINC
+      {0, 3, 0, 1, k_unit_param_type_strings, 0, 0, 0, {"INTERP"}},
+
+      // Record mode: ONESHOT, RING, MONO, MONORING, OVERDUB
+      {0, 4, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"REC"}},
+
+      // Number of slices the take is split into along the X axis
+      {1, 16, 0, 8, k_unit_param_type_none, 0, 0, 0, {"SLICES"}},
+
+      // Note value each slice lasts, tempo synced: OFF, 1/16, 1/8, 1/4, 1/2, 1/1
+      {0, 5, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"SYNC"}},
+
+      // Quantize to the tempo grid: OFF, 1/16 (play mode touches), BAR (touches
+      // and one shot recording start/stop)
+      {0, 2, 0, 0, k_unit_param_type_strings, 0, 0, 0, {"QUANT"}}},
   },
   .default_mappings = {
     // By default, the parameters described above will be mapped to controls as described below.
@@ -82,18 +92,25 @@ const __unit_header genericfx_unit_header_t unit_header = {
     // PARAM1 mapped full range to X axis of control pad, initialized at 256
     {k_genericfx_param_assign_x, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 1023, 256},
 
-    // PARAM2 mapped half range to Y axis of control pad, initialized at 512
-    {k_genericfx_param_assign_y, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 512, 1023, 512},
+    // LOOP set to the fixed value of 0 (OFF)
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 2, 0},
 
     // DEPTH mapped full range to depth control, with a bipolar exponential curve and i initialized at 0
     {k_genericfx_param_assign_depth, k_genericfx_curve_exp, k_genericfx_curve_bipolar, -1000, 1000, 0},
 
-    // PARAM4 set to the fixed value of 1
+    // INTERP set to the fixed value of 1 (LINEAR)
     {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 3, 1},
-    
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0},
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0},
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0},
-    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 0, 0}
+
+    // REC set to the fixed value of 0 (ONESHOT)
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 4, 0},
+
+    // SLICES set to the fixed value of 8
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 1, 16, 8},
+
+    // SYNC set to the fixed value of 0 (OFF)
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 5, 0},
+
+    // QUANT set to the fixed value of 0 (OFF)
+    {k_genericfx_param_assign_none, k_genericfx_curve_linear, k_genericfx_curve_unipolar, 0, 2, 0}
   }
 };
@@ -0,0 +1,386 @@
+/*
+ *  File: bench.cc
+ *
+ *  Render callback microbenchmark. Drives Effect::Process() in each of its
+ *  modes across block sizes of 1..256 frames and reports the cost per frame,
+ *  optionally as a JSON summary that later runs can be compared against.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "unit_genericfx.h"
+
+#include "effect.h"
+#include "host_runtime.h"
+
+namespace {
+
+  typedef std::chrono::steady_clock Clock;
+
+  enum {
+    MAX_BLOCK_FRAMES = 256,
+    // Frames rendered between two untimed prepare() calls, short enough for
+    // every mode to stay in the same state for the whole segment.
+    SEGMENT_FRAMES = 4096,
+    // Frames rendered per measurement, per block size.
+    TOTAL_FRAMES = 1 << 20,
+    REPEATS = 5,
+  };
+
+  Effect s_effect;
+  float s_in[MAX_BLOCK_FRAMES * 2];
+  float s_out[MAX_BLOCK_FRAMES * 2];
+  volatile float s_sink;
+
+  void render_untimed(uint32_t frames) {
+    while (frames) {
+      const uint32_t n = std::min<uint32_t>(frames, MAX_BLOCK_FRAMES);
+      s_effect.Process(s_in, s_out, n);
+      frames -= n;
+    }
+  }
+
+  void touch(uint32_t x, uint32_t y) {
+    s_effect.touchEvent(0, k_unit_touch_phase_began, x, y);
+    s_effect.touchEvent(0, k_unit_touch_phase_ended, x, y);
+  }
+
+  void record_whole_buffer() {
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    touch(0, 0);
+    render_untimed(s_effect.bufferFrames());
+  }
+
+  // ---- Scenarios --------------------------------------------------------------
+
+  struct Scenario {
+    const char *name;
+    void (*setup)();   // once per block size, untimed
+    void (*prepare)(); // before each segment, untimed
+  };
+
+  void no_op() {}
+
+  void setup_record() {
+    s_effect.setParameter(Effect::DEPTH, -1000);
+  }
+
+  void prepare_record() {
+    touch(0, 0);
+  }
+
+  void setup_record_ring() {
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_RING);
+    s_effect.setParameter(Effect::DEPTH, -1000);
+  }
+
+  void setup_record_mono() {
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_MONO);
+    s_effect.setParameter(Effect::DEPTH, -1000);
+  }
+
+  // Overdub the whole buffer, looped, keeping 3/4 of it per pass
+  void setup_overdub() {
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_OVERDUB);
+    record_whole_buffer();
+    s_effect.setParameter(Effect::DEPTH, -750);
+    touch(0, 0);
+  }
+
+  void setup_record_full() {
+    record_whole_buffer();
+  }
+
+  template <uint32_t Speed, uint32_t Interp = INTERP_DROP>
+  void prepare_play() {
+    // Note: voices from the previous segment would still be playing
+    s_effect.Reset();
+    s_effect.setParameter(Effect::DEPTH, 1000);
+    s_effect.setParameter(Effect::INTERP, Interp);
+    touch(0, (Speed - 1) << 8);
+  }
+
+  // Half dry, half wet
+  void prepare_play_mix() {
+    prepare_play<2, INTERP_LINEAR>();
+    s_effect.setParameter(Effect::DEPTH, 500);
+  }
+
+  // Layer Voices slices, all played at Speed
+  template <uint32_t Voices, uint32_t Speed = 2>
+  void prepare_play_voices() {
+    s_effect.Reset();
+    s_effect.setParameter(Effect::DEPTH, 1000);
+    s_effect.setParameter(Effect::INTERP, INTERP_LINEAR);
+    for (uint32_t v = 0; v < Voices; ++v)
+      touch(v << 7, (Speed - 1) << 8);
+  }
+
+  // Hold a looping 1024 frame slice, wrapping every 512 frames at 2x
+  template <uint32_t Loop>
+  void prepare_play_loop() {
+    s_effect.Reset();
+    s_effect.setParameter(Effect::DEPTH, 1000);
+    s_effect.setParameter(Effect::INTERP, INTERP_LINEAR);
+    s_effect.setParameter(Effect::LOOP, Loop);
+    s_effect.touchEvent(0, k_unit_touch_phase_began, 0, 1 << 8);
+  }
+
+  void setup_play() {
+    record_whole_buffer();
+  }
+
+  // A 4096 frame take in 4 slices
+  void setup_play_short() {
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    s_effect.setParameter(Effect::SLICES, 4);
+    touch(0, 0);
+    render_untimed(4096);
+    s_effect.setParameter(Effect::DEPTH, 1000);
+  }
+
+  void setup_play_mono() {
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_MONO);
+    record_whole_buffer();
+  }
+
+  void setup_play_idle() {
+    record_whole_buffer();
+    prepare_play<4>();
+    // Run well past the end of the slice
+    render_untimed(s_effect.bufferFrames());
+  }
+
+  const Scenario s_scenarios[] = {
+      {"record", setup_record, prepare_record},
+      {"record_full", setup_record_full, no_op},
+      {"record_ring", setup_record_ring, no_op},
+      {"record_mono", setup_record_mono, prepare_record},
+      {"overdub", setup_overdub, no_op},
+      {"play_1x", setup_play, prepare_play<1>},
+      {"play_2x", setup_play, prepare_play<2>},
+      {"play_3x", setup_play, prepare_play<3>},
+      {"play_4x", setup_play, prepare_play<4>},
+      {"play_2x_linear", setup_play, prepare_play<2, INTERP_LINEAR>},
+      {"play_2x_hermite", setup_play, prepare_play<2, INTERP_HERMITE>},
+      {"play_2x_sinc", setup_play, prepare_play<2, INTERP_SINC>},
+      {"play_2x_mix", setup_play, prepare_play_mix},
+      {"play_2x_mono", setup_play_mono, prepare_play<2, INTERP_LINEAR>},
+      {"play_2x_mono_sinc", setup_play_mono, prepare_play<2, INTERP_SINC>},
+      {"play_2x_voices1", setup_play, prepare_play_voices<1>},
+      {"play_2x_voices2", setup_play, prepare_play_voices<2>},
+      {"play_2x_voices3", setup_play, prepare_play_voices<3>},
+      {"play_2x_voices4", setup_play, prepare_play_voices<4>},
+      {"play_2x_loop", setup_play_short, prepare_play_loop<Effect::LOOP_ON>},
+      {"play_2x_loop_xfade", setup_play_short, prepare_play_loop<Effect::LOOP_XFADE>},
+      {"play_idle", setup_play_idle, no_op},
+  };
+
+  const uint32_t s_block_sizes[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+  // ---- Measurement ------------------------------------------------------------
+
+  struct Result {
+    std::string mode;
+    uint32_t frames;
+    double ns_per_frame;
+  };
+
+  void reinit() {
+    s_effect.Teardown();
+    host_sdram_release_all();
+    unit_runtime_desc_t desc;
+    host_runtime_init_desc(&desc);
+    if (s_effect.Init(&desc) != k_unit_err_none) {
+      std::fprintf(stderr, "Effect::Init failed\n");
+      std::exit(1);
+    }
+    s_effect.Resume();
+    // Let the progressive clear finish so it is not part of the measurements
+    while (s_effect.isClearing())
+      s_effect.Process(s_in, s_out, MAX_BLOCK_FRAMES);
+  }
+
+  // Time Effect::Init() alone, as the runtime does when loading the unit.
+  double measure_init_us() {
+    enum { INIT_REPEATS = 20 };
+    double best = 0.0;
+    host_sdram_set_poison(false);
+    for (int r = 0; r < INIT_REPEATS; ++r) {
+      s_effect.Teardown();
+      host_sdram_release_all();
+      unit_runtime_desc_t desc;
+      host_runtime_init_desc(&desc);
+      const Clock::time_point t0 = Clock::now();
+      s_effect.Init(&desc);
+      const double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+      if (r == 0 || us < best)
+        best = us;
+    }
+    host_sdram_set_poison(true);
+    return best;
+  }
+
+  double measure(const Scenario &sc, uint32_t block) {
+    double best = 0.0;
+    for (int r = 0; r < REPEATS; ++r) {
+      reinit();
+      sc.setup();
+
+      const uint32_t blocks_per_segment = std::max<uint32_t>(SEGMENT_FRAMES / block, 1);
+      uint64_t frames = 0;
+      Clock::duration elapsed = Clock::duration::zero();
+      while (frames < TOTAL_FRAMES) {
+        sc.prepare();
+        const Clock::time_point t0 = Clock::now();
+        for (uint32_t b = 0; b < blocks_per_segment; ++b)
+          s_effect.Process(s_in, s_out, block);
+        elapsed += Clock::now() - t0;
+        frames += static_cast<uint64_t>(blocks_per_segment) * block;
+        s_sink = s_out[0];
+      }
+
+      const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / frames;
+      if (r == 0 || ns < best)
+        best = ns;
+    }
+    return best;
+  }
+
+  // ---- Reporting --------------------------------------------------------------
+
+  bool write_json(const char *path, double init_us, const std::vector<Result> &results) {
+    FILE *f = std::fopen(path, "w");
+    if (!f)
+      return false;
+    std::fprintf(f, "{\n  \"benchmark\": \"unit_render\",\n");
+    std::fprintf(f, "  \"init_us\": %.2f,\n", init_us);
+    std::fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result &r = results[i];
+      // Note: one result per line, read back by load_baseline()
+      std::fprintf(f,
+                   "    {\"mode\": \"%s\", \"frames\": %u, \"ns_per_frame\": %.4f, "
+                   "\"ns_per_block\": %.2f, \"frames_per_sec\": %.0f}%s\n",
+                   r.mode.c_str(), r.frames, r.ns_per_frame, r.ns_per_frame * r.frames,
+                   1e9 / r.ns_per_frame, (i + 1 < results.size()) ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    std::fclose(f);
+    return true;
+  }
+
+  bool load_baseline(const char *path, double &init_us, std::vector<Result> &results) {
+    FILE *f = std::fopen(path, "r");
+    if (!f)
+      return false;
+    char line[512];
+    while (std::fgets(line, sizeof(line), f)) {
+      char mode[64];
+      Result r;
+      if (std::sscanf(line, " \"init_us\": %lf", &init_us) == 1)
+        continue;
+      if (std::sscanf(line, " {\"mode\": \"%63[^\"]\", \"frames\": %u, \"ns_per_frame\": %lf", mode,
+                      &r.frames, &r.ns_per_frame) == 3) {
+        r.mode = mode;
+        results.push_back(r);
+      }
+    }
+    std::fclose(f);
+    return true;
+  }
+
+  const Result *find(const std::vector<Result> &results, const std::string &mode, uint32_t frames) {
+    for (size_t i = 0; i < results.size(); ++i)
+      if (results[i].mode == mode && results[i].frames == frames)
+        return &results[i];
+    return nullptr;
+  }
+
+  void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [-o out.json] [-c baseline.json] [mode...]\n"
+                 "  -o path  write the JSON summary to path\n"
+                 "  -c path  compare against a previous JSON summary\n"
+                 "  mode     only run the named modes\n",
+                 argv0);
+  }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const char *json_path = nullptr;
+  const char *baseline_path = nullptr;
+  std::vector<std::string> filter;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (!std::strcmp(argv[i], "-c") && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 1;
+    } else {
+      filter.push_back(argv[i]);
+    }
+  }
+
+  std::vector<Result> baseline;
+  double baseline_init_us = 0.0;
+  if (baseline_path && !load_baseline(baseline_path, baseline_init_us, baseline)) {
+    std::fprintf(stderr, "cannot read %s\n", baseline_path);
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < MAX_BLOCK_FRAMES * 2; ++i)
+    s_in[i] = (std::rand() / static_cast<float>(RAND_MAX)) - 0.5f;
+
+  const double init_us = measure_init_us();
+  std::printf("Effect::Init: %.1f us", init_us);
+  if (baseline_init_us > 0.0)
+    std::printf("   %+7.1f%% vs baseline", 100.0 * (init_us - baseline_init_us) / baseline_init_us);
+  std::printf("\n\n");
+
+  std::printf("%-16s %6s %12s %12s %14s%s\n", "mode", "frames", "ns/frame", "ns/block", "frames/sec",
+              baseline.empty() ? "" : "   vs baseline");
+
+  std::vector<Result> results;
+  for (size_t s = 0; s < sizeof(s_scenarios) / sizeof(s_scenarios[0]); ++s) {
+    const Scenario &sc = s_scenarios[s];
+    if (!filter.empty() && std::find(filter.begin(), filter.end(), sc.name) == filter.end())
+      continue;
+    for (size_t b = 0; b < sizeof(s_block_sizes) / sizeof(s_block_sizes[0]); ++b) {
+      Result r;
+      r.mode = sc.name;
+      r.frames = s_block_sizes[b];
+      r.ns_per_frame = measure(sc, r.frames);
+      results.push_back(r);
+
+      std::printf("%-16s %6u %12.3f %12.1f %14.0f", r.mode.c_str(), r.frames, r.ns_per_frame,
+                  r.ns_per_frame * r.frames, 1e9 / r.ns_per_frame);
+      const Result *base = find(baseline, r.mode, r.frames);
+      if (base)
+        std::printf("   %+7.1f%%", 100.0 * (r.ns_per_frame - base->ns_per_frame) / base->ns_per_frame);
+      std::printf("\n");
+      std::fflush(stdout);
+    }
+  }
+
+  s_effect.Teardown();
+  host_sdram_release_all();
+
+  if (json_path && !write_json(json_path, init_us, results)) {
+    std::fprintf(stderr, "cannot write %s\n", json_path);
+    return 1;
+  }
+
+  return 0;
+}
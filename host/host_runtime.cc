@@ -0,0 +1,96 @@
+/*
+ *  File: host_runtime.cc
+ *
+ *  Host stand-in for the runtime side of the unit API.
+ *
+ */
+
+#include "host_runtime.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "unit_genericfx.h"
+
+namespace {
+
+  // NTS-3 grants units a few megabytes of SDRAM; this is a comfortable default.
+  size_t s_capacity = 0x400000;
+  size_t s_used = 0;
+  bool s_poison = true;
+
+  struct Block {
+    uint8_t *mem;
+    size_t size;
+  };
+  std::vector<Block> s_blocks;
+
+  uint8_t *sdram_alloc(size_t size) {
+    if (size == 0 || s_used + size > s_capacity)
+      return nullptr;
+    uint8_t *mem = static_cast<uint8_t *>(std::malloc(size));
+    if (!mem)
+      return nullptr;
+    // SDRAM is not cleared by the runtime, poison it so reads of memory the
+    // unit never wrote are loud instead of silently zero.
+    if (s_poison)
+      std::memset(mem, 0x7F, size);
+    s_blocks.push_back(Block{mem, size});
+    s_used += size;
+    return mem;
+  }
+
+  void sdram_free(const uint8_t *mem) {
+    for (size_t i = 0; i < s_blocks.size(); ++i) {
+      if (s_blocks[i].mem == mem) {
+        s_used -= s_blocks[i].size;
+        std::free(s_blocks[i].mem);
+        s_blocks.erase(s_blocks.begin() + i);
+        return;
+      }
+    }
+  }
+
+  size_t sdram_avail() {
+    return s_capacity - s_used;
+  }
+
+} // namespace
+
+void host_runtime_init_desc(unit_runtime_desc_t *desc, uint16_t frames_per_buffer) {
+  std::memset(desc, 0, sizeof(*desc));
+  desc->target = unit_header.common.target;
+  desc->api = UNIT_API_VERSION;
+  desc->samplerate = 48000;
+  desc->frames_per_buffer = frames_per_buffer;
+  desc->input_channels = 2;
+  desc->output_channels = 2;
+  desc->hooks.runtime_context = nullptr;
+  desc->hooks.sdram_alloc = sdram_alloc;
+  desc->hooks.sdram_free = sdram_free;
+  desc->hooks.sdram_avail = sdram_avail;
+}
+
+void host_sdram_set_capacity(size_t bytes) {
+  s_capacity = bytes;
+}
+
+size_t host_sdram_capacity() {
+  return s_capacity;
+}
+
+void host_sdram_set_poison(bool poison) {
+  s_poison = poison;
+}
+
+size_t host_sdram_used() {
+  return s_used;
+}
+
+void host_sdram_release_all() {
+  for (size_t i = 0; i < s_blocks.size(); ++i)
+    std::free(s_blocks[i].mem);
+  s_blocks.clear();
+  s_used = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/*
+ *  File: host_runtime.h
+ *
+ *  Host stand-in for the runtime side of the unit API: builds a runtime
+ *  descriptor matching the NTS-3 kaoss pad kit and backs the sdram_alloc
+ *  hook with heap memory.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "unit.h"
+
+// Fill a runtime descriptor as the NTS-3 would before calling unit_init().
+void host_runtime_init_desc(unit_runtime_desc_t *desc, uint16_t frames_per_buffer = 64);
+
+// Limit the total amount of memory the fake sdram_alloc hook will hand out.
+void host_sdram_set_capacity(size_t bytes);
+
+// The limit set by host_sdram_set_capacity().
+size_t host_sdram_capacity();
+
+// Fill memory handed out by the fake sdram_alloc hook with garbage (default),
+// so reads of memory the unit never wrote show up in the output.
+void host_sdram_set_poison(bool poison);
+
+// Bytes currently handed out by the fake sdram_alloc hook.
+size_t host_sdram_used();
+
+// Free every block handed out so far, as the runtime does after unit teardown.
+void host_sdram_release_all();
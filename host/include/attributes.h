@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ *  File: attributes.h
+ *
+ *  Host stand-in for the logue SDK common attribute macros.
+ *
+ */
+
+#define fast_inline inline __attribute__((optimize("Ofast"), always_inline))
+
+#define __fast_inline static fast_inline
+
+#define __sdram
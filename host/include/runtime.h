@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+ *  File: runtime.h
+ *
+ *  Host stand-in for the logue SDK platform/module target definitions.
+ *
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  enum {
+    k_unit_module_global = 0U,
+    k_unit_module_genericfx,
+    k_num_unit_modules,
+  };
+
+  enum {
+    k_unit_target_nts3_kaoss = (6U << 8),
+  };
+
+#define UNIT_TARGET_PLATFORM (k_unit_target_nts3_kaoss)
+#define UNIT_TARGET_PLATFORM_MASK (0x7FU << 8)
+#define UNIT_TARGET_MODULE_MASK (0x7FU)
+
+#define UNIT_API_MAJOR_MASK (0x7FU << 16)
+#define UNIT_API_MINOR_MASK (0xFFU << 8)
+#define UNIT_API_PATCH_MASK (0xFFU)
+
+#define UNIT_API_VERSION 0x00010000U
+
+#define UNIT_API_IS_COMPAT(api) \
+  ((((api) & UNIT_API_MAJOR_MASK) == (UNIT_API_VERSION & UNIT_API_MAJOR_MASK)) \
+   && (((api) & UNIT_API_MINOR_MASK) <= (UNIT_API_VERSION & UNIT_API_MINOR_MASK)))
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+ *  File: unit.h
+ *
+ *  Host stand-in for the logue SDK unit API: header layout, runtime
+ *  descriptor, error codes and callback prototypes.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attributes.h"
+#include "runtime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  enum {
+    k_unit_err_none = 0,
+    k_unit_err_target = -1,
+    k_unit_err_api_version = -2,
+    k_unit_err_samplerate = -4,
+    k_unit_err_geometry = -8,
+    k_unit_err_memory = -16,
+    k_unit_err_undef = -32,
+  };
+
+  enum {
+    k_unit_param_type_none = 0U,
+    k_unit_param_type_percent,
+    k_unit_param_type_db,
+    k_unit_param_type_cents,
+    k_unit_param_type_semi,
+    k_unit_param_type_oct,
+    k_unit_param_type_hertz,
+    k_unit_param_type_khertz,
+    k_unit_param_type_bpm,
+    k_unit_param_type_msec,
+    k_unit_param_type_sec,
+    k_unit_param_type_enum,
+    k_unit_param_type_strings,
+    k_unit_param_type_bitmaps,
+    k_unit_param_type_drywet,
+    k_unit_param_type_pan,
+    k_unit_param_type_spread,
+    k_unit_param_type_onoff,
+    k_unit_param_type_midi_note,
+    k_num_unit_param_type
+  };
+
+  enum {
+    k_unit_touch_phase_began = 0U,
+    k_unit_touch_phase_moved,
+    k_unit_touch_phase_ended,
+    k_unit_touch_phase_stationary,
+    k_unit_touch_phase_cancelled,
+    k_num_unit_touch_phases,
+  };
+
+#define UNIT_NAME_LEN 13
+#define UNIT_PARAM_NAME_LEN 12
+#define UNIT_MAX_PARAM_COUNT 8
+
+  typedef struct unit_param {
+    int16_t min;
+    int16_t max;
+    int16_t center;
+    int16_t init;
+    uint8_t type;
+    uint8_t frac : 4;
+    uint8_t frac_mode : 1;
+    uint8_t reserved : 3;
+    char name[UNIT_PARAM_NAME_LEN + 1];
+  } unit_param_t;
+
+  typedef struct unit_header {
+    uint32_t header_size;
+    uint16_t target;
+    uint32_t api;
+    uint32_t dev_id;
+    uint32_t unit_id;
+    uint32_t version;
+    char name[UNIT_NAME_LEN + 1];
+    uint32_t num_params;
+    unit_param_t params[UNIT_MAX_PARAM_COUNT];
+  } unit_header_t;
+
+  typedef uint8_t *(*unit_runtime_sdram_alloc_ptr)(size_t size);
+  typedef void (*unit_runtime_sdram_free_ptr)(const uint8_t *mem);
+  typedef size_t (*unit_runtime_sdram_avail_ptr)(void);
+
+  typedef struct unit_runtime_hooks {
+    const void *runtime_context;
+    unit_runtime_sdram_alloc_ptr sdram_alloc;
+    unit_runtime_sdram_free_ptr sdram_free;
+    unit_runtime_sdram_avail_ptr sdram_avail;
+  } unit_runtime_hooks_t;
+
+  typedef struct unit_runtime_desc {
+    uint16_t target;
+    uint32_t api;
+    uint32_t samplerate;
+    uint16_t frames_per_buffer;
+    uint8_t input_channels;
+    uint8_t output_channels;
+    unit_runtime_hooks_t hooks;
+  } unit_runtime_desc_t;
+
+#define __unit_callback __attribute__((used))
+#define __unit_header __attribute__((used))
+
+  __unit_callback int8_t unit_init(const unit_runtime_desc_t *desc);
+  __unit_callback void unit_teardown();
+  __unit_callback void unit_reset();
+  __unit_callback void unit_resume();
+  __unit_callback void unit_suspend();
+  __unit_callback void unit_render(const float *in, float *out, uint32_t frames);
+  __unit_callback void unit_set_param_value(uint8_t id, int32_t value);
+  __unit_callback int32_t unit_get_param_value(uint8_t id);
+  __unit_callback const char *unit_get_param_str_value(uint8_t id, int32_t value);
+  __unit_callback void unit_set_tempo(uint32_t tempo);
+  __unit_callback void unit_tempo_4ppqn_tick(uint32_t counter);
+  __unit_callback void unit_touch_event(uint8_t id, uint8_t phase, uint32_t x, uint32_t y);
+
+  static inline float param_10bit_to_f32(int16_t val) {
+    return val * 9.77517106549365e-004f; // 1/1023
+  }
+
+  static inline int16_t param_f32_to_10bit(float val) {
+    return (int16_t)(val * 1023);
+  }
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+ *  File: unit_genericfx.h
+ *
+ *  Host stand-in for the logue SDK generic effect unit definitions.
+ *
+ */
+
+#include "unit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  enum {
+    k_genericfx_param_assign_none = 0U,
+    k_genericfx_param_assign_x,
+    k_genericfx_param_assign_y,
+    k_genericfx_param_assign_depth,
+    k_num_genericfx_param_assign,
+  };
+
+  enum {
+    k_genericfx_curve_linear = 0U,
+    k_genericfx_curve_exp,
+    k_genericfx_curve_log,
+    k_genericfx_curve_toggle,
+    k_genericfx_curve_minclip,
+    k_genericfx_curve_maxclip,
+    k_num_genericfx_curve,
+  };
+
+  enum {
+    k_genericfx_curve_unipolar = 0U,
+    k_genericfx_curve_bipolar,
+    k_num_genericfx_curve_polarity,
+  };
+
+  typedef struct genericfx_param_mapping {
+    uint8_t assign;
+    uint8_t curve;
+    uint8_t curve_polarity;
+    int16_t min;
+    int16_t max;
+    int16_t value;
+  } genericfx_param_mapping_t;
+
+  typedef struct genericfx_unit_header {
+    unit_header_t common;
+    genericfx_param_mapping_t default_mappings[UNIT_MAX_PARAM_COUNT];
+  } genericfx_unit_header_t;
+
+  extern const genericfx_unit_header_t unit_header;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+/*
+ *  File: buffer_ops.h
+ *
+ *  Host stand-in for the logue SDK buffer utilities.
+ *
+ */
+
+#include <stdint.h>
+
+#include "attributes.h"
+
+__fast_inline void buf_clr_f32(float * __restrict__ ptr, const uint32_t len) {
+  for (uint32_t n = len; n != 0; --n)
+    *(ptr++) = 0.f;
+}
+
+__fast_inline void buf_clr_u32(uint32_t * __restrict__ ptr, const uint32_t len) {
+  for (uint32_t n = len; n != 0; --n)
+    *(ptr++) = 0;
+}
+
+__fast_inline void buf_cpy_f32(const float * __restrict__ src, float * __restrict__ dst, const uint32_t len) {
+  for (uint32_t n = len; n != 0; --n)
+    *(dst++) = *(src++);
+}
+
+__fast_inline void buf_cpy_u32(const uint32_t * __restrict__ src, uint32_t * __restrict__ dst, const uint32_t len) {
+  for (uint32_t n = len; n != 0; --n)
+    *(dst++) = *(src++);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ *  File: int_math.h
+ *
+ *  Host stand-in for the logue SDK integer math utilities.
+ *
+ */
+
+#include <stdint.h>
+
+#include "attributes.h"
+
+__fast_inline int32_t clipmini32(int32_t m, int32_t x) {
+  return (x < m) ? m : x;
+}
+
+__fast_inline int32_t clipmaxi32(int32_t x, int32_t m) {
+  return (x > m) ? m : x;
+}
+
+__fast_inline int32_t clipminmaxi32(int32_t min, int32_t x, int32_t max) {
+  return (x >= max) ? max : (x < min) ? min : x;
+}
+
+__fast_inline uint32_t clipminu32(uint32_t m, uint32_t x) {
+  return (x < m) ? m : x;
+}
+
+__fast_inline uint32_t clipmaxu32(uint32_t x, uint32_t m) {
+  return (x > m) ? m : x;
+}
+
+__fast_inline uint32_t clipminmaxu32(uint32_t min, uint32_t x, uint32_t max) {
+  return (x >= max) ? max : (x < min) ? min : x;
+}
@@ -0,0 +1,209 @@
+/*
+ *  File: render.cc
+ *
+ *  Offline driver for the unit callbacks. Records an input signal, then
+ *  triggers a slice and renders the playback, the same way the NTS-3 would
+ *  drive the unit from its audio and touch handlers.
+ *
+ *  Input and output are raw interleaved stereo float32 at 48 kHz.
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "unit_genericfx.h"
+
+#include "effect.h"
+#include "host_runtime.h"
+
+namespace {
+
+  void usage(const char *argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [-b frames] [-x x] [-y y] [-d depth] [-i interp] [-r rec] [-s slices] [-l loop] [-m bytes] [in.f32 [out.f32]]\n"
+                 "  -b frames  render block size (default 64)\n"
+                 "  -x x       touch x used to pick the slice, 0..1023 (default 0)\n"
+                 "  -y y       touch y used to pick the speed, 0..1023 (default 0)\n"
+                 "  -d depth   DEPTH value used for playback, 0..1000 (default 1000)\n"
+                 "  -i interp  INTERP value: 0 drop, 1 linear, 2 hermite, 3 sinc (default 1)\n"
+                 "  -r rec     REC value: 0 one shot, 1 ring, 2 mono, 3 mono ring, 4 overdub (default 0)\n"
+                 "  -s slices  SLICES value, 1..16 (default 8)\n"
+                 "  -l loop    LOOP value: 0 off, 1 on, 2 crossfaded (default 0)\n"
+                 "  -m bytes   SDRAM the runtime grants (default 4194304)\n"
+                 "Without an input file a 2 s 440 Hz tone is recorded.\n",
+                 argv0);
+  }
+
+  bool read_input(const char *path, std::vector<float> &buf) {
+    FILE *f = std::fopen(path, "rb");
+    if (!f)
+      return false;
+    float tmp[512];
+    size_t n;
+    while ((n = std::fread(tmp, sizeof(float), 512, f)) != 0)
+      buf.insert(buf.end(), tmp, tmp + n);
+    std::fclose(f);
+    buf.resize(buf.size() & ~static_cast<size_t>(1));
+    return true;
+  }
+
+  void synth_input(std::vector<float> &buf) {
+    const size_t frames = 2 * 48000;
+    buf.resize(frames * 2);
+    for (size_t i = 0; i < frames; ++i) {
+      const float s = 0.5f * std::sin(2.f * static_cast<float>(M_PI) * 440.f * i / 48000.f);
+      buf[2 * i + 0] = s;
+      buf[2 * i + 1] = s;
+    }
+  }
+
+  void render(const std::vector<float> &in, std::vector<float> &out, uint32_t block) {
+    const size_t frames = in.size() / 2;
+    out.assign(in.size(), 0.f);
+    for (size_t i = 0; i < frames; i += block) {
+      const uint32_t n = (frames - i < block) ? static_cast<uint32_t>(frames - i) : block;
+      unit_render(&in[2 * i], &out[2 * i], n);
+    }
+  }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t block = 64;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  int32_t depth = 1000;
+  int32_t interp = INTERP_LINEAR;
+  int32_t rec = Effect::REC_ONESHOT;
+  int32_t slices = 8;
+  int32_t loop = Effect::LOOP_OFF;
+  long sdram = 0;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i += 2) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const long v = std::strtol(argv[i + 1], nullptr, 10);
+    switch (argv[i][1]) {
+    case 'b':
+      block = static_cast<uint32_t>(v);
+      break;
+    case 'x':
+      x = static_cast<uint32_t>(v);
+      break;
+    case 'y':
+      y = static_cast<uint32_t>(v);
+      break;
+    case 'd':
+      depth = static_cast<int32_t>(v);
+      break;
+    case 'i':
+      interp = static_cast<int32_t>(v);
+      break;
+    case 'r':
+      rec = static_cast<int32_t>(v);
+      break;
+    case 's':
+      slices = static_cast<int32_t>(v);
+      break;
+    case 'l':
+      loop = static_cast<int32_t>(v);
+      break;
+    case 'm':
+      sdram = v;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (block == 0 || argc - i > 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<float> in;
+  if (i < argc) {
+    if (!read_input(argv[i], in)) {
+      std::fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 1;
+    }
+  } else {
+    synth_input(in);
+  }
+  const char *out_path = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+  if (sdram > 0)
+    host_sdram_set_capacity(static_cast<size_t>(sdram));
+  unit_runtime_desc_t desc;
+  host_runtime_init_desc(&desc, static_cast<uint16_t>(block));
+  const int8_t err = unit_init(&desc);
+  if (err != k_unit_err_none) {
+    std::fprintf(stderr, "unit_init failed: %d\n", err);
+    return 1;
+  }
+  unit_resume();
+
+  std::vector<float> out;
+
+  // Record the input. In ring mode capture runs untouched, and the touch
+  // freezes it afterwards.
+  unit_set_param_value(Effect::REC_MODE, rec);
+  unit_set_param_value(Effect::SLICES, slices);
+  unit_set_param_value(Effect::DEPTH, -1000);
+  const bool ring = rec == Effect::REC_RING || rec == Effect::REC_MONO_RING;
+  if (!ring)
+    unit_touch_event(0, k_unit_touch_phase_began, 0, 0);
+  render(in, out, block);
+  if (ring)
+    unit_touch_event(0, k_unit_touch_phase_began, 0, 0);
+  unit_touch_event(0, k_unit_touch_phase_ended, 0, 0);
+
+  // In overdub mode a second tap loops the take, play the input over it once
+  // more and stop
+  if (rec == Effect::REC_OVERDUB) {
+    unit_touch_event(0, k_unit_touch_phase_began, 0, 0);
+    render(in, out, block);
+    unit_touch_event(0, k_unit_touch_phase_began, 0, 0);
+  }
+
+  // Trigger a slice and render the playback over silence, the touch is held
+  // throughout so a looping slice keeps playing
+  std::vector<float> silence(in.size(), 0.f);
+  unit_set_param_value(Effect::DEPTH, depth);
+  unit_set_param_value(Effect::INTERP, interp);
+  unit_set_param_value(Effect::LOOP, loop);
+  unit_touch_event(0, k_unit_touch_phase_began, x, y);
+  render(silence, out, block);
+  unit_touch_event(0, k_unit_touch_phase_ended, x, y);
+
+  unit_suspend();
+  unit_teardown();
+  host_sdram_release_all();
+
+  float peak = 0.f;
+  double sum = 0.0;
+  for (size_t k = 0; k < out.size(); ++k) {
+    peak = std::fmax(peak, std::fabs(out[k]));
+    sum += static_cast<double>(out[k]) * out[k];
+  }
+  std::fprintf(stderr, "frames: %zu  peak: %.6f  rms: %.6f\n", out.size() / 2, peak,
+               out.empty() ? 0.0 : std::sqrt(sum / out.size()));
+
+  if (out_path) {
+    FILE *f = std::fopen(out_path, "wb");
+    if (!f || std::fwrite(out.data(), sizeof(float), out.size(), f) != out.size()) {
+      std::fprintf(stderr, "cannot write %s\n", out_path);
+      return 1;
+    }
+    std::fclose(f);
+  }
+
+  return 0;
+}
@@ -0,0 +1,1030 @@
+/*
+ *  File: test.cc
+ *
+ *  Host tests. Checks the sample codecs and the render path against the
+ *  behaviour and the figures the change log states. Prints one line per
+ *  check and exits non zero if any fails.
+ *
+ */
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "unit_genericfx.h"
+
+#include "adpcm.h"
+#include "effect.h"
+#include "host_runtime.h"
+#include "interpolator.h"
+
+namespace {
+
+  enum {
+    BLOCK_FRAMES = 64,
+    TICK_FRAMES_180_BPM = 4000, // 48000 * 60 / (4 * 180)
+    BAR_FRAMES_180_BPM = TICK_FRAMES_180_BPM * Effect::TICKS_PER_BAR,
+  };
+
+  Effect s_effect;
+  uint32_t s_failures = 0;
+
+  // Largest error of a stored sample: 1 LSB of dither or rounding for the
+  // 16-bit stores, none for float
+  const float STORE_LSB = (sizeof(Effect::sample_t) == 2) ? 1.f / 32768.f : 0.f;
+
+  void check(bool ok, const char *fmt, ...) {
+    std::printf("%s ", ok ? "ok  " : "FAIL");
+    va_list args;
+    va_start(args, fmt);
+    std::vprintf(fmt, args);
+    va_end(args);
+    std::printf("\n");
+    if (!ok)
+      ++s_failures;
+  }
+
+  double db(double ratio) {
+    return 20.0 * std::log10(ratio + 1e-12);
+  }
+
+  // Amplitude of the f Hz component of x, Hann windowed.
+  double tone_level(const std::vector<float> &x, double f) {
+    double re = 0.0, im = 0.0, w = 0.0;
+    const size_t n = x.size();
+    for (size_t i = 0; i < n; ++i) {
+      const double h = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / n);
+      re += h * x[i] * std::cos(2.0 * M_PI * f * i / 48000.0);
+      im += h * x[i] * std::sin(2.0 * M_PI * f * i / 48000.0);
+      w += h;
+    }
+    return 2.0 * std::sqrt(re * re + im * im) / w;
+  }
+
+  // ---- Effect driver ----------------------------------------------------------
+
+  // Input signal, frame counted from the start of render()
+  typedef float (*Signal)(uint32_t frame);
+
+  float s_level = 0.f;
+  double s_freq = 0.0;
+
+  float silence(uint32_t) {
+    return 0.f;
+  }
+
+  float dc(uint32_t) {
+    return s_level;
+  }
+
+  float tone(uint32_t frame) {
+    return s_level * static_cast<float>(std::sin(2.0 * M_PI * s_freq * frame / 48000.0));
+  }
+
+  // Rises by 1/4096 per frame
+  float ramp(uint32_t frame) {
+    return frame / 4096.f;
+  }
+
+  // Fresh unit, by default once the buffer is cleared
+  void reinit(bool wait_clear = true) {
+    s_effect.Teardown();
+    host_sdram_release_all();
+    unit_runtime_desc_t desc;
+    host_runtime_init_desc(&desc);
+    if (s_effect.Init(&desc) != k_unit_err_none) {
+      std::fprintf(stderr, "Effect::Init failed\n");
+      std::exit(1);
+    }
+    s_effect.Resume();
+    float in[BLOCK_FRAMES * 2] = {}, out[BLOCK_FRAMES * 2];
+    while (wait_clear && s_effect.isClearing())
+      s_effect.Process(in, out, BLOCK_FRAMES);
+  }
+
+  // 4ppqn ticks of a 180 BPM transport posted while rendering
+  enum {
+    TICKS_NONE = 0,
+    TICKS_BLOCK, // at the start of the block they fall in, as the runtime does
+    TICKS_EXACT, // on their frame, blocks are split there
+  };
+
+  // Render frames frames of signal on both channels in blocks of block frames,
+  // appending the left output to left if given.
+  void render(uint32_t frames, Signal signal, std::vector<float> *left = nullptr, uint32_t ticks = TICKS_NONE,
+              uint32_t block = BLOCK_FRAMES) {
+    float in[BLOCK_FRAMES * 2], out[BLOCK_FRAMES * 2];
+    for (uint32_t done = 0; done < frames;) {
+      uint32_t n = (frames - done < block) ? frames - done : block;
+      if (ticks != TICKS_NONE) {
+        const uint32_t now = s_effect.frameCounter();
+        const uint32_t next = (now + TICK_FRAMES_180_BPM - 1) / TICK_FRAMES_180_BPM * TICK_FRAMES_180_BPM;
+        if (ticks == TICKS_EXACT && next != now && next - now < n)
+          n = next - now;
+        if (next - now < n)
+          s_effect.tempo4ppqnTick(next / TICK_FRAMES_180_BPM);
+      }
+      for (uint32_t i = 0; i < n; ++i)
+        in[2 * i] = in[2 * i + 1] = signal(done + i);
+      s_effect.Process(in, out, n);
+      if (left)
+        for (uint32_t i = 0; i < n; ++i)
+          left->push_back(out[2 * i]);
+      done += n;
+    }
+  }
+
+  // Render frames frames of a signal on each channel, appending both outputs.
+  void render_lr(uint32_t frames, Signal left, Signal right, std::vector<float> *out_left,
+                 std::vector<float> *out_right) {
+    float in[BLOCK_FRAMES * 2], out[BLOCK_FRAMES * 2];
+    for (uint32_t done = 0; done < frames;) {
+      const uint32_t n = (frames - done < (uint32_t)BLOCK_FRAMES) ? frames - done : (uint32_t)BLOCK_FRAMES;
+      for (uint32_t i = 0; i < n; ++i) {
+        in[2 * i] = left(done + i);
+        in[2 * i + 1] = right(done + i);
+      }
+      s_effect.Process(in, out, n);
+      for (uint32_t i = 0; i < n; ++i) {
+        out_left->push_back(out[2 * i]);
+        out_right->push_back(out[2 * i + 1]);
+      }
+      done += n;
+    }
+  }
+
+  void tap(uint32_t x = 0, uint32_t y = 0) {
+    s_effect.touchEvent(0, k_unit_touch_phase_began, x, y);
+    s_effect.touchEvent(0, k_unit_touch_phase_ended, x, y);
+  }
+
+  // One shot take of frames frames of signal, in slices slices
+  void record(uint32_t frames, Signal signal, uint32_t slices) {
+    s_effect.setParameter(Effect::SLICES, slices);
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    tap();
+    render(frames, signal);
+  }
+
+  // Fully wet, with the DEPTH ramp done
+  void play_mode() {
+    s_effect.setParameter(Effect::DEPTH, 1000);
+    render(SMOOTH_FRAMES * 2, silence);
+  }
+
+  size_t first_nonzero(const std::vector<float> &x) {
+    size_t i = 0;
+    while (i < x.size() && x[i] == 0.f)
+      ++i;
+    return i;
+  }
+
+  // One past the last non zero sample
+  size_t nonzero_end(const std::vector<float> &x) {
+    size_t i = x.size();
+    while (i && x[i - 1] == 0.f)
+      --i;
+    return i;
+  }
+
+  // Largest step of x from frame begin on
+  float max_step(const std::vector<float> &x, size_t begin) {
+    float step = 0.f;
+    for (size_t i = begin; i < x.size(); ++i)
+      step = std::fmax(step, std::fabs(x[i] - x[i - 1]));
+    return step;
+  }
+
+  // Largest change of slope of x from begin on
+  float max_bend(const std::vector<float> &x, size_t begin) {
+    float bend = 0.f;
+    for (size_t i = begin; i < x.size(); ++i)
+      bend = std::fmax(bend, std::fabs(x[i] - 2.f * x[i - 1] + x[i - 2]));
+    return bend;
+  }
+
+  // ---- Interpolators ----------------------------------------------------------
+
+  // A signal of continuous time, in frames
+  typedef double (*Curve)(double t);
+
+  double slope(double t) {
+    return 0.01 * t - 0.5;
+  }
+
+  double parabola(double t) {
+    return 0.0002 * (t - 100.0) * (t - 100.0) - 0.5;
+  }
+
+  double constant(double) {
+    return 0.4;
+  }
+
+  // 1 kHz
+  double sine(double t) {
+    return 0.5 * std::sin(2.0 * M_PI * 1000.0 * t / 48000.0);
+  }
+
+  // 15 kHz
+  double high(double t) {
+    return 0.5 * std::sin(2.0 * M_PI * 15000.0 * t / 48000.0);
+  }
+
+  // Largest error of a kernel reading frames of curve, the right channel
+  // negated, at fractional positions. DROP is compared with the frame it
+  // holds, the others with the curve.
+  template <uint32_t Mode, uint32_t Channels>
+  double interp_error(Curve curve) {
+    enum { FRAMES = 256, READS = 1000 };
+    std::vector<float> buf(FRAMES * Channels);
+    for (uint32_t i = 0; i < FRAMES; ++i)
+      for (uint32_t c = 0; c < Channels; ++c)
+        buf[i * Channels + c] = static_cast<float>(c ? -curve(i) : curve(i));
+    double error = 0.0;
+    for (uint32_t k = 0; k < READS; ++k) {
+      const uint64_t phase = static_cast<uint64_t>((16.0 + k * 0.2113) * 4294967296.0);
+      const double t = (Mode == INTERP_DROP) ? static_cast<double>(phase >> 32) : phase / 4294967296.0;
+      const double right = (Channels == 2) ? -curve(t) : curve(t);
+      float out[2];
+      Interpolator<Mode, SampleF32, Channels>::render(buf.data(), phase, out);
+      error = std::fmax(error, std::fmax(std::fabs(out[0] - curve(t)), std::fabs(out[1] - right)));
+    }
+    return error;
+  }
+
+  // Each kernel reproduces the signals its order allows, in both layouts. On
+  // a 1 kHz tone each stays within its bound, near the top of the band the
+  // sinc kernel follows a tone the closest.
+  template <uint32_t Channels>
+  void test_interp() {
+    SincTable::init();
+    const double exact[] = {
+        interp_error<INTERP_DROP, Channels>(sine),
+        interp_error<INTERP_LINEAR, Channels>(slope),
+        interp_error<INTERP_HERMITE, Channels>(parabola),
+        interp_error<INTERP_SINC, Channels>(constant),
+    };
+    check(exact[0] <= 1e-6 && exact[1] <= 1e-6 && exact[2] <= 1e-6 && exact[3] <= 1e-6,
+          "interp: %u channel drop holds frames, linear a slope, hermite a parabola, sinc DC, off by %g %g %g %g",
+          Channels, exact[0], exact[1], exact[2], exact[3]);
+
+    const double low[] = {
+        db(interp_error<INTERP_LINEAR, Channels>(sine) / 0.5),
+        db(interp_error<INTERP_HERMITE, Channels>(sine) / 0.5),
+        db(interp_error<INTERP_SINC, Channels>(sine) / 0.5),
+    };
+    check(low[0] <= -50.0 && low[1] <= -85.0 && low[2] <= -70.0,
+          "interp: %u channel 1 kHz error of linear %.1f dB, hermite %.1f dB, sinc %.1f dB, at most -50, -85, -70",
+          Channels, low[0], low[1], low[2]);
+
+    const double top[] = {
+        interp_error<INTERP_LINEAR, Channels>(high),
+        interp_error<INTERP_HERMITE, Channels>(high),
+        interp_error<INTERP_SINC, Channels>(high),
+    };
+    check(top[2] < top[1] && top[1] < top[0],
+          "interp: %u channel 15 kHz error of sinc %.1f dB, below hermite %.1f dB, below linear %.1f dB", Channels,
+          db(top[2] / 0.5), db(top[1] / 0.5), db(top[0] / 0.5));
+  }
+
+  // ---- ADPCM storage ----------------------------------------------------------
+
+  typedef AdpcmStore<2> TestAdpcmStore;
+
+  struct AdpcmFixture {
+    std::vector<uint8_t> mem;
+    TestAdpcmStore store;
+
+    AdpcmFixture() : mem(TestAdpcmStore::bytes(TestAdpcmStore::MIN_FRAMES)) {
+      store.init(mem.data(), TestAdpcmStore::MIN_FRAMES);
+      while (store.isClearing())
+        store.clearProgressive();
+    }
+
+    // Write frames frames of signal at frame 0 of level 0
+    void write(uint32_t frames, Signal signal) {
+      float in[BLOCK_FRAMES * 2];
+      for (uint32_t done = 0; done < frames; done += BLOCK_FRAMES) {
+        for (uint32_t i = 0; i < BLOCK_FRAMES; ++i) {
+          in[2 * i] = signal(done + i);
+          in[2 * i + 1] = -signal(done + i);
+        }
+        store.write(in, done, BLOCK_FRAMES);
+      }
+    }
+
+    // Decode frames frames of the first channel of a level from frame, with
+    // the reader of voice
+    template <uint32_t Channels>
+    std::vector<int16_t> read(uint32_t voice, uint32_t level, uint32_t frame, uint32_t frames) {
+      std::vector<int16_t> x;
+      while (x.size() < frames) {
+        uint64_t phase = static_cast<uint64_t>(frame + x.size()) << 32;
+        uint32_t n = frames - static_cast<uint32_t>(x.size());
+        const int16_t *w = store.read<Channels>(voice, level, phase, 1ULL << 32, n);
+        const uint32_t first = static_cast<uint32_t>(phase >> 32);
+        for (uint32_t i = 0; i < n; ++i)
+          x.push_back(w[(first + i) * Channels]);
+      }
+      return x;
+    }
+  };
+
+  // Tones up to 440 Hz come back at least 43 dB above the coding noise. The
+  // SNR falls with the frequency, as the gain of the first order predictor.
+  void test_adpcm_snr() {
+    struct Case {
+      double freq;
+      double min_db;
+    };
+    static const Case cases[] = {{110.0, 43.0}, {440.0, 43.0}, {1000.0, 37.0}, {5000.0, 22.0}};
+    enum { FRAMES = 48000, SETTLE_FRAMES = 256 };
+    AdpcmFixture f;
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+      s_level = 0.5f;
+      s_freq = cases[k].freq;
+      f.store.reset(false, 2);
+      f.write(FRAMES, tone);
+      const std::vector<int16_t> x = f.read<2>(0, 0, 0, FRAMES);
+      double signal = 0.0, noise = 0.0;
+      for (uint32_t i = SETTLE_FRAMES; i < FRAMES; ++i) {
+        const double ref = tone(i) * 32768.0;
+        signal += ref * ref;
+        noise += (x[i] - ref) * (x[i] - ref);
+      }
+      const double snr = 10.0 * std::log10(signal / noise);
+      check(snr >= cases[k].min_db, "adpcm: %.0f Hz tone SNR %.1f dB, at least %.0f dB", cases[k].freq, snr,
+            cases[k].min_db);
+    }
+  }
+
+  // A reader seeking anywhere decodes the same samples as one running from
+  // the start, in every level and both layouts
+  void test_adpcm_seek() {
+    static const uint32_t starts[] = {1, 63, 64, 65, 127, 128, 1000, 12345, 20000};
+    enum { FRAMES = 32768, RUN_FRAMES = 300 };
+    AdpcmFixture f;
+    s_level = 0.5f;
+    s_freq = 1234.0;
+    for (uint32_t channels = 1; channels <= 2; ++channels) {
+      f.store.reset(false, channels);
+      f.write(FRAMES, tone);
+      for (uint32_t level = 1; level < NUM_MIP_LEVELS; ++level)
+        f.store.decimate(level, 0, FRAMES >> level);
+      bool same = true;
+      for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level) {
+        const uint32_t frames = FRAMES >> level;
+        const std::vector<int16_t> whole =
+            (channels == 1) ? f.read<1>(0, level, 0, frames) : f.read<2>(0, level, 0, frames);
+        for (size_t k = 0; k < sizeof(starts) / sizeof(starts[0]); ++k) {
+          const uint32_t start = starts[k] >> level;
+          const std::vector<int16_t> run = (channels == 1) ? f.read<1>(1, level, start, RUN_FRAMES)
+                                                           : f.read<2>(1, level, start, RUN_FRAMES);
+          same = same && !std::memcmp(run.data(), whole.data() + start, RUN_FRAMES * sizeof(int16_t));
+        }
+      }
+      check(same, "adpcm: %u channel seeks decode what a reader from the start does", channels);
+    }
+  }
+
+  // A ring take starts on a block of every level, and a reader crossing the
+  // end of a ring level carries on at its start
+  void test_adpcm_ring() {
+    AdpcmFixture f;
+    for (uint32_t channels = 1; channels <= 2; ++channels) {
+      f.store.reset(true, channels);
+      const uint32_t align = f.store.alignFrames();
+      const uint32_t block = TestAdpcmStore::BLOCK_BYTES * 2 / channels;
+      bool aligned = true;
+      for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+        aligned = aligned && !((align >> level) % block) && !(f.store.levelFrames(level) % (align >> level));
+      check(aligned, "adpcm: %u channel ring alignment of %u frames is whole blocks in every level", channels,
+            align);
+
+      const uint32_t frames = f.store.levelFrames(0);
+      s_level = 0.5f;
+      s_freq = 440.0;
+      f.write(frames, tone);
+      const std::vector<int16_t> head = (channels == 1) ? f.read<1>(0, 0, 0, 256) : f.read<2>(0, 0, 0, 256);
+      const std::vector<int16_t> wrap =
+          (channels == 1) ? f.read<1>(1, 0, frames - 100, 356) : f.read<2>(1, 0, frames - 100, 356);
+      check(!std::memcmp(head.data(), wrap.data() + 100, 256 * sizeof(int16_t)),
+            "adpcm: %u channel ring reader wraps from the end to the start", channels);
+    }
+  }
+
+  // A ring take recorded while the buffer is still being cleared plays the
+  // same as one recorded after: the frames before its start, at the other
+  // end of the ring, are silence in every level. The host poisons uncleared
+  // memory, 4x reads the levels the decimator filled across the wrap.
+  // Note: quiet, the ADPCM encoder slews too slowly at the start of a loud
+  //       take to show what it decimated
+  void test_ring_clearing() {
+    static const uint32_t modes[] = {Effect::REC_RING, Effect::REC_MONO_RING};
+    s_level = 0.01f;
+    for (size_t k = 0; k < sizeof(modes) / sizeof(modes[0]); ++k) {
+      std::vector<float> out[2];
+      bool clearing = true;
+      for (uint32_t run = 0; run < 2; ++run) {
+        reinit(run == 0);
+        s_effect.setParameter(Effect::REC_MODE, modes[k]);
+        s_effect.setParameter(Effect::SLICES, 1);
+        s_effect.setParameter(Effect::DEPTH, -1000);
+        render(200 * BLOCK_FRAMES, dc);
+        if (run == 1)
+          clearing = s_effect.isClearing();
+        tap();
+        play_mode();
+        tap(0, 3 << 8);
+        render(120 * BLOCK_FRAMES, silence, &out[run]);
+      }
+      check(clearing && out[0] == out[1],
+            "ring: %s take recorded while clearing plays as one recorded after, at 4x",
+            (modes[k] == Effect::REC_RING) ? "stereo" : "mono");
+    }
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_ONESHOT);
+  }
+
+  // ---- SDRAM ------------------------------------------------------------------
+
+  // Init claims the largest multiple of MIN_FRAMES the runtime grants, and a
+  // take fills what it claimed
+  void test_sdram_probe() {
+    typedef Effect::Store Store;
+    const size_t capacity = host_sdram_capacity();
+    struct Case {
+      size_t bytes;
+      uint32_t frames; // 0: Init fails
+    };
+    const Case cases[] = {
+        {Store::bytes(Store::MAX_FRAMES), Store::MAX_FRAMES},
+        {Store::bytes(Store::MAX_FRAMES) - 1, Store::MAX_FRAMES - Store::MIN_FRAMES},
+        {Store::bytes(5 * Store::MIN_FRAMES) + Store::bytes(Store::MIN_FRAMES) / 2, 5 * Store::MIN_FRAMES},
+        {Store::bytes(Store::MIN_FRAMES), Store::MIN_FRAMES},
+        {Store::bytes(Store::MIN_FRAMES) - 1, 0},
+    };
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+      s_effect.Teardown();
+      host_sdram_release_all();
+      host_sdram_set_capacity(cases[k].bytes);
+      unit_runtime_desc_t desc;
+      host_runtime_init_desc(&desc);
+      const int8_t err = s_effect.Init(&desc);
+      if (!cases[k].frames) {
+        check(err == k_unit_err_memory, "sdram: %zu bytes, less than the smallest buffer, fail Init", cases[k].bytes);
+        continue;
+      }
+      check(err == k_unit_err_none && s_effect.bufferFrames() == cases[k].frames,
+            "sdram: %zu bytes give a %u frame buffer, %u", cases[k].bytes, s_effect.bufferFrames(), cases[k].frames);
+    }
+
+    // The smallest buffer, a take longer than it is cut there
+    host_sdram_set_capacity(Store::bytes(Store::MIN_FRAMES));
+    reinit();
+    s_level = 0.25f;
+    record(Store::MIN_FRAMES + 1000, dc, 1);
+    play_mode();
+    check(s_effect.takeFrames() == Store::MIN_FRAMES, "sdram: a take fills the %u frame buffer, %u",
+          s_effect.takeFrames(), Store::MIN_FRAMES);
+    host_sdram_set_capacity(capacity);
+  }
+
+  // ---- SYNC and QUANT ---------------------------------------------------------
+
+  // QUANT BAR one shot recording is cut on bars, computed from the tempo
+  void test_bar_take() {
+    reinit();
+    s_effect.setTempo(180 << 16);
+    s_effect.setParameter(Effect::QUANT, Effect::QUANT_BAR);
+    s_effect.setParameter(Effect::SLICES, 4);
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    render(BLOCK_FRAMES, silence, nullptr, TICKS_BLOCK);
+    tap();
+    // Armed, recording starts on the next bar
+    s_level = 0.25f;
+    uint32_t waited = 0;
+    while (!s_effect.takeFrames() && waited <= BAR_FRAMES_180_BPM) {
+      render(BLOCK_FRAMES, dc, nullptr, TICKS_BLOCK);
+      waited += BLOCK_FRAMES;
+    }
+    check(waited <= BAR_FRAMES_180_BPM, "quant: bar recording starts within a bar (%u frames)", waited);
+    render(BAR_FRAMES_180_BPM * 3 / 2, dc, nullptr, TICKS_BLOCK);
+    // Stops on the next bar
+    tap();
+    render(BAR_FRAMES_180_BPM, dc, nullptr, TICKS_BLOCK);
+    check(s_effect.takeFrames() == 128000, "quant: 2 bars at 180 BPM give a %u frame take, 128000",
+          s_effect.takeFrames());
+  }
+
+  // In SYNC mode a slice lasts its note value at 1x
+  void test_sync() {
+    reinit();
+    s_effect.setTempo(180 << 16);
+    s_level = 0.25f;
+    record(128000, dc, 4);
+    s_effect.setParameter(Effect::SYNC, Effect::SYNC_1_4);
+    play_mode();
+    std::vector<float> out;
+    // A 32000 frame slice over a quarter note at 180 BPM, 16000 frames
+    tap(0, 0);
+    render(2 * 16000, silence, &out);
+    const size_t end = nonzero_end(out);
+    check(end >= 16000 - 2 && end <= 16000, "sync: 1/4 slice at 180 BPM plays %zu frames, 16000", end);
+
+    out.clear();
+    s_effect.setParameter(Effect::SYNC, Effect::SYNC_1_8);
+    tap(0, 1 << 8); // 2x
+    render(16000, silence, &out);
+    const size_t end_2x = nonzero_end(out);
+    check(end_2x >= 4000 - 2 && end_2x <= 4000, "sync: 1/8 slice at 2x plays %zu frames, 4000", end_2x);
+  }
+
+  // QUANT 1/16 holds a tap back to the next 4ppqn tick
+  void test_quant_tick() {
+    reinit();
+    s_effect.setTempo(180 << 16);
+    s_level = 0.25f;
+    record(48000, dc, 4);
+    play_mode();
+    s_effect.setParameter(Effect::QUANT, Effect::QUANT_1_16);
+    // Lock the grid to ticks on their frame, it moves by 1/8 of each error
+    render(64 * TICK_FRAMES_180_BPM, silence, nullptr, TICKS_EXACT);
+    const uint32_t now = s_effect.frameCounter();
+    const uint32_t at = now + 1000;
+    const uint32_t tick = (at / TICK_FRAMES_180_BPM + 1) * TICK_FRAMES_180_BPM;
+    s_effect.touchEventAt(at, 0, k_unit_touch_phase_began, 0, 0);
+    s_effect.touchEventAt(at, 0, k_unit_touch_phase_ended, 0, 0);
+    std::vector<float> out;
+    render(2 * TICK_FRAMES_180_BPM, silence, &out, TICKS_EXACT);
+    // Note: the fade in starts from 0
+    const size_t start = now + first_nonzero(out) - 1;
+    check(start == tick, "quant: a 1/16 tap fires on frame %zu, the tick at %u", start, tick);
+  }
+
+  // ---- Voices -----------------------------------------------------------------
+
+  // Retriggering DC slices steps by at most 0.047 per frame
+  void test_fades() {
+    reinit();
+    s_level = 1.f;
+    record(48000, dc, 8);
+    play_mode();
+    std::vector<float> out;
+    for (uint32_t k = 0; k < 64; ++k) {
+      tap((k * 389) & 1023, 0);
+      render(300 + (k * 97) % 700, silence, &out, TICKS_NONE, (k % 3) ? BLOCK_FRAMES : 7);
+    }
+    render(12000, silence, &out);
+    float step = 0.f;
+    for (size_t i = 1; i < out.size(); ++i)
+      step = std::fmax(step, std::fabs(out[i] - out[i - 1]));
+    check(step <= 0.047f, "fades: retriggered DC steps by at most %.3f per frame, 0.047", step);
+  }
+
+  // The mip levels keep images of the take well below it, see mipLevel().
+  // Note: ADPCM encodes each level again, its distortion of these high tones
+  //       lands on the image well above what the decimator leaves, so the
+  //       check only bounds it by the 22 dB SNR the codec has at 5 kHz.
+  void test_mip_alias() {
+    struct Case {
+      double freq;
+      uint32_t speed;
+      double max_db;
+    };
+#if defined(SAMPLE_STORAGE_ADPCM)
+    static const Case cases[] = {{9000.0, 3, -22.0}, {7000.0, 4, -22.0}};
+#else
+    static const Case cases[] = {{9000.0, 3, -120.0}, {7000.0, 4, -58.0}};
+#endif
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+      reinit();
+      s_level = 0.5f;
+      s_freq = cases[k].freq;
+      record(65536, tone, 1);
+      s_effect.setParameter(Effect::DEPTH, 1000);
+      tap(0, (cases[k].speed - 1) << 8);
+      std::vector<float> out;
+      render(160 * BLOCK_FRAMES, silence, &out);
+      // Past the wet ramp and the fade in
+      out.erase(out.begin(), out.begin() + 32 * BLOCK_FRAMES);
+      const double image = 48000.0 - cases[k].freq * cases[k].speed;
+      const double level = db(tone_level(out, image) / 0.5);
+      check(level <= cases[k].max_db, "mip: %.0f Hz at %ux leaves a %.0f Hz image at %.1f dB, at most %.0f dB",
+            cases[k].freq, cases[k].speed, image, level, cases[k].max_db);
+    }
+  }
+
+  // A one shot take shorter than the one before plays silence past its end,
+  // in every level. Dithered silence is a few LSB in the 16-bit stores.
+  void test_take_end() {
+    static const uint32_t speeds[] = {1, 2, 4};
+    reinit();
+    for (size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); ++k) {
+      s_level = 0.5f;
+      record(400 * BLOCK_FRAMES, dc, 1);
+      record(64 * BLOCK_FRAMES, silence, 1);
+      play_mode();
+      std::vector<float> out;
+      tap(0, (speeds[k] - 1) << 8);
+      render(80 * BLOCK_FRAMES, silence, &out);
+      float peak = 0.f;
+      for (size_t i = 0; i < out.size(); ++i)
+        peak = std::fmax(peak, std::fabs(out[i]));
+      check(peak <= 4.f * STORE_LSB, "take end: a silent take after a loud one plays %g peak at %ux", peak, speeds[k]);
+    }
+  }
+
+  // Play mode ends a one shot recording: back in record mode the take is
+  // kept, and the next tap records a new one whose levels hold no trace of
+  // the pause
+  void test_rec_pause() {
+    static const uint32_t speeds[] = {2, 4};
+    enum { PAUSE_FRAMES = 1024, TAKE_FRAMES = 4096 };
+    reinit();
+    record(PAUSE_FRAMES, ramp, 1);
+    play_mode();
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    render(PAUSE_FRAMES, ramp);
+    check(s_effect.takeFrames() == PAUSE_FRAMES, "rec pause: record mode after play keeps the %u frame take, %u",
+          s_effect.takeFrames(), PAUSE_FRAMES);
+
+    tap();
+    render(TAKE_FRAMES, ramp);
+    play_mode();
+    for (size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); ++k) {
+      std::vector<float> out;
+      tap(0, (speeds[k] - 1) << 8);
+      render(TAKE_FRAMES / speeds[k] - FADE_FRAMES, silence, &out);
+      const float bend = max_bend(out, FADE_FRAMES + 2);
+      const float max = 32.f * STORE_LSB + 1e-5f;
+      check(bend <= max, "rec pause: the next take bends by %.6f at %ux, at most %.6f", bend, speeds[k], max);
+      render(2 * FADE_FRAMES, silence);
+    }
+  }
+
+  // ---- Dry and wet ------------------------------------------------------------
+
+  // With no voice playing the voice loops are skipped: the output is the dry
+  // input at 1 - DEPTH, the same as with a voice playing silence. Checked
+  // before, during and after a voice plays a silent take, in place, and
+  // fully wet.
+  void test_idle() {
+    enum { TAKE_FRAMES = 16 * BLOCK_FRAMES };
+    const float max_error = 4.f * STORE_LSB + 1e-6f;
+    reinit();
+    record(TAKE_FRAMES, silence, 1);
+    s_effect.setParameter(Effect::DEPTH, 500);
+    s_level = 0.4f;
+    render(SMOOTH_FRAMES * 2, dc);
+    std::vector<float> out;
+    render(BLOCK_FRAMES, dc, &out);
+    tap();
+    render(TAKE_FRAMES + 4 * BLOCK_FRAMES, dc, &out);
+    float error = 0.f;
+    for (size_t i = 0; i < out.size(); ++i)
+      error = std::fmax(error, std::fabs(out[i] - 0.2f));
+    check(error <= max_error, "idle: DEPTH 50.0 plays half the input around a silent voice, off by %g", error);
+
+    float buf[BLOCK_FRAMES * 2];
+    for (uint32_t i = 0; i < BLOCK_FRAMES * 2; ++i)
+      buf[i] = 0.4f;
+    s_effect.Process(buf, buf, BLOCK_FRAMES);
+    error = 0.f;
+    for (uint32_t i = 0; i < BLOCK_FRAMES * 2; ++i)
+      error = std::fmax(error, std::fabs(buf[i] - 0.2f));
+    check(error <= 1e-6f, "idle: the same in place, off by %g", error);
+
+    s_effect.setParameter(Effect::DEPTH, 1000);
+    render(SMOOTH_FRAMES * 2, dc);
+    out.clear();
+    render(BLOCK_FRAMES, dc, &out);
+    check(nonzero_end(out) == 0, "idle: fully wet, it is silent");
+  }
+
+  // While a take plays, DEPTH mixes it with the dry input, and a change of
+  // DEPTH ramps the mix over SMOOTH_FRAMES at most. The same in place, where
+  // the dry input is kept aside before the voices overwrite it.
+  void test_dry_wet() {
+    enum { TAKE_FRAMES = 8192, MIX_FRAMES = 4 * BLOCK_FRAMES, RAMP_FRAMES = 16 * BLOCK_FRAMES };
+    const float take = 0.5f, dry = -0.25f;
+    const float max_error = 4.f * STORE_LSB + 1e-6f;
+    std::vector<float> out[2];
+    for (uint32_t run = 0; run < 2; ++run) {
+      reinit();
+      s_level = take;
+      record(TAKE_FRAMES, dc, 1);
+      s_effect.setParameter(Effect::DEPTH, 500);
+      render(SMOOTH_FRAMES * 2, silence);
+      tap();
+      float buf[BLOCK_FRAMES * 2], other[BLOCK_FRAMES * 2];
+      for (uint32_t done = 0; done < FADE_FRAMES + MIX_FRAMES + RAMP_FRAMES; done += BLOCK_FRAMES) {
+        if (done == FADE_FRAMES + MIX_FRAMES)
+          s_effect.setParameter(Effect::DEPTH, 1000);
+        for (uint32_t i = 0; i < BLOCK_FRAMES * 2; ++i)
+          buf[i] = dry;
+        float *dst = run ? buf : other;
+        s_effect.Process(buf, dst, BLOCK_FRAMES);
+        for (uint32_t i = 0; i < BLOCK_FRAMES; ++i)
+          out[run].push_back(dst[2 * i]);
+      }
+    }
+
+    const std::vector<float> &x = out[0];
+    const float mix = 0.5f * take + 0.5f * dry;
+    float error = 0.f;
+    for (size_t i = FADE_FRAMES; i < FADE_FRAMES + MIX_FRAMES; ++i)
+      error = std::fmax(error, std::fabs(x[i] - mix));
+    check(error <= max_error, "dry/wet: DEPTH 50.0 plays %.3f of take and input, off by %g", mix, error);
+    const float step = max_step(x, FADE_FRAMES + MIX_FRAMES);
+    const float max = (take - dry) / SMOOTH_FRAMES + max_error;
+    check(std::fabs(x.back() - take) <= max_error && step <= max,
+          "dry/wet: DEPTH 100.0 ramps to the take by %.6f per frame, at most %.6f", step, max);
+    check(out[0] == out[1], "dry/wet: the same in place");
+  }
+
+  // ---- Mono layouts -----------------------------------------------------------
+
+  // A mono take plays the mean of both input channels on both outputs, off
+  // by the dither of the mean in the 16-bit stores. ADPCM adds its coding
+  // noise, see test_adpcm_snr().
+  void test_mono() {
+    enum { TAKE_FRAMES = 8192 };
+#if defined(SAMPLE_STORAGE_ADPCM)
+    const float max_error = 0.002f;
+#else
+    const float max_error = 1e-6f + 2.f * STORE_LSB;
+#endif
+    reinit();
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_MONO);
+    s_level = 0.25f;
+    s_freq = 440.0;
+    s_effect.setParameter(Effect::SLICES, 1);
+    s_effect.setParameter(Effect::DEPTH, -1000);
+    tap();
+    std::vector<float> left, right;
+    render_lr(TAKE_FRAMES, tone, dc, &left, &right);
+    play_mode();
+    left.clear();
+    right.clear();
+    tap();
+    render_lr(TAKE_FRAMES, silence, silence, &left, &right);
+    float error = 0.f;
+    for (uint32_t i = FADE_FRAMES; i < TAKE_FRAMES - FADE_FRAMES; ++i) {
+      const float mean = 0.5f * (tone(i) + dc(i));
+      error = std::fmax(error, std::fmax(std::fabs(left[i] - mean), std::fabs(right[i] - mean)));
+    }
+    check(error <= max_error, "mono: a take plays the mean of both channels on both, off by %.6f, at most %.6f",
+          error, max_error);
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_ONESHOT);
+  }
+
+  // A mono take of an odd number of frames after a loud one plays silence
+  // past its end, in every level: ADPCM keeps two frames per byte, the last
+  // one in the low nibble of a byte the earlier take filled
+  void test_mono_odd_end() {
+    static const uint32_t speeds[] = {1, 2, 4};
+    enum { TAKE_FRAMES = 64 * BLOCK_FRAMES + 1 };
+    reinit();
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_MONO);
+    for (size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); ++k) {
+      s_level = 0.5f;
+      record(400 * BLOCK_FRAMES, dc, 1);
+      record(TAKE_FRAMES, silence, 1);
+      play_mode();
+      const bool odd = s_effect.takeFrames() == TAKE_FRAMES;
+      std::vector<float> out;
+      tap(0, (speeds[k] - 1) << 8);
+      render(80 * BLOCK_FRAMES, silence, &out);
+      float peak = 0.f;
+      for (size_t i = 0; i < out.size(); ++i)
+        peak = std::fmax(peak, std::fabs(out[i]));
+      check(odd && peak <= 4.f * STORE_LSB, "mono: a silent %u frame take after a loud one plays %g peak at %ux",
+            s_effect.takeFrames(), peak, speeds[k]);
+    }
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_ONESHOT);
+  }
+
+  // REC_OVERDUB loops the take, playing it under the input and mixing the
+  // input into it, keeping -DEPTH of what it held
+  void test_overdub() {
+    enum { LOOP_FRAMES = 4096 };
+    if (!Effect::Store::CAN_OVERDUB) {
+      check(true, "overdub: not supported by this storage, skipped");
+      return;
+    }
+    reinit();
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_OVERDUB);
+    s_level = 0.25f;
+    record(LOOP_FRAMES, dc, 8);
+    s_effect.setParameter(Effect::DEPTH, -750);
+    tap();
+    std::vector<float> out;
+    render(2 * LOOP_FRAMES, dc, &out);
+    check(s_effect.takeFrames() == LOOP_FRAMES, "overdub: the loop is the %u frames recorded, %u",
+          s_effect.takeFrames(), LOOP_FRAMES);
+    // Input over the take, then over the take with the first pass mixed in
+    const float first = out[LOOP_FRAMES / 2], second = out[LOOP_FRAMES + LOOP_FRAMES / 2];
+    check(std::fabs(first - 0.5f) < 1e-6f && std::fabs(second - 0.6875f) < 1e-6f,
+          "overdub: passes play %g then %g, 0.5 then 0.6875", first, second);
+    tap();
+    play_mode();
+    out.clear();
+    tap(0, 0);
+    render(LOOP_FRAMES / 8, silence, &out);
+    // 0.75 * (0.75 * 0.25 + 0.25) + 0.25
+    const float held = out[LOOP_FRAMES / 16];
+    check(std::fabs(held - 0.578125f) < 1e-6f + 2.f * STORE_LSB, "overdub: the take holds %g after two passes, 0.578125", held);
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_ONESHOT);
+  }
+
+  // Moving DEPTH while overdubbing ramps what the take keeps, rather than
+  // writing a step into it. Keeping all of a 0.25 DC loop, then almost none
+  // of it, ramps the take down by at most 1 / SMOOTH_FRAMES per frame.
+  void test_overdub_ramp() {
+    enum { LOOP_FRAMES = 4096 };
+    if (!Effect::Store::CAN_OVERDUB) {
+      check(true, "overdub: not supported by this storage, skipped");
+      return;
+    }
+    reinit();
+    s_effect.setParameter(Effect::REC_MODE, Effect::REC_OVERDUB);
+    s_level = 0.25f;
+    record(LOOP_FRAMES, dc, 1);
+    tap();
+    render(LOOP_FRAMES / 4, silence);
+    s_effect.setParameter(Effect::DEPTH, -1);
+    render(LOOP_FRAMES * 3 / 4, silence);
+    tap();
+    play_mode();
+    std::vector<float> out;
+    tap(0, 0);
+    render(LOOP_FRAMES, silence, &out);
+    float step = 0.f;
+    for (size_t i = FADE_FRAMES + 1; i < LOOP_FRAMES - FADE_FRAMES; ++i)
+      step = std::fmax(step, std::fabs(out[i] - out[i - 1]));
+    const float max_step = 0.25f / SMOOTH_FRAMES + 2.f * STORE_LSB + 1e-6f;
+    check(out[LOOP_FRAMES / 8] > 0.24f && out[LOOP_FRAMES / 2] < 0.01f && step <= max_step,
+          "overdub: DEPTH moved during a pass ramps the take by at most %.5f per frame, %.5f", step, max_step);
+  }
+
+  // A held looping slice wraps back to its start, and plays to its end once
+  // released
+  void test_loop_wrap() {
+    enum { SLICE_FRAMES = 1024 };
+    reinit();
+    record(4 * SLICE_FRAMES, ramp, 4);
+    play_mode();
+    s_effect.setParameter(Effect::LOOP, Effect::LOOP_ON);
+    std::vector<float> out;
+    s_effect.touchEvent(0, k_unit_touch_phase_began, 0, 0);
+    render(5 * SLICE_FRAMES - 100, silence, &out, TICKS_NONE, 37);
+    s_effect.touchEvent(0, k_unit_touch_phase_ended, 0, 0);
+    render(2 * SLICE_FRAMES, silence, &out);
+    bool wraps = true;
+    for (uint32_t i = FADE_FRAMES; i < 5 * SLICE_FRAMES - FADE_FRAMES; ++i)
+      wraps = wraps && std::fabs(out[i] - ramp(i % SLICE_FRAMES)) < 1e-6f + STORE_LSB;
+    check(wraps, "loop: a held slice plays its frames again from its start");
+    const size_t end = nonzero_end(out);
+    check(end == 5 * SLICE_FRAMES - 1, "loop: released, it plays to the slice end at %zu, %u", end,
+          5 * SLICE_FRAMES - 1);
+    s_effect.setParameter(Effect::LOOP, Effect::LOOP_OFF);
+  }
+
+  // LOOP_XFADE seams of voices wrapping close together, and a voice stolen
+  // right after it wraps, each fade out in full. The last slice fades out to
+  // the take end and in again. Over DC slices a cut tail would step by a
+  // large part of 0.25.
+  void test_loop_xfade() {
+    enum { SLICE_FRAMES = 1024 };
+    reinit();
+    s_level = 0.25f;
+    record(4 * SLICE_FRAMES, dc, 4);
+    play_mode();
+    s_effect.setParameter(Effect::LOOP, Effect::LOOP_XFADE);
+    render(BLOCK_FRAMES, silence);
+    const uint32_t t0 = s_effect.frameCounter() + BLOCK_FRAMES;
+    static const uint32_t starts[Effect::NUM_VOICES] = {0, 20, 40, 300};
+    for (uint8_t v = 0; v < Effect::NUM_VOICES; ++v)
+      s_effect.touchEventAt(t0 + starts[v], v, k_unit_touch_phase_began, v << 8, 0);
+    // Steals the first voice 10 frames after its first seam
+    s_effect.touchEventAt(t0 + SLICE_FRAMES + 10, 4, k_unit_touch_phase_began, 0, 0);
+    std::vector<float> out;
+    render(3 * SLICE_FRAMES, silence, &out);
+    float step = 0.f;
+    for (size_t i = BLOCK_FRAMES + starts[Effect::NUM_VOICES - 1] + FADE_FRAMES + 1; i < out.size(); ++i)
+      step = std::fmax(step, std::fabs(out[i] - out[i - 1]));
+    check(step <= 0.25f * 0.047f, "loop: crossfaded seams and steals step by at most %.4f per frame, %.4f", step,
+          0.25f * 0.047f);
+    s_effect.setParameter(Effect::LOOP, Effect::LOOP_OFF);
+  }
+
+  // X of slice of slices
+  uint32_t slice_x(uint32_t slice, uint32_t slices) {
+    return (slice * 1024 + slices - 1) / slices;
+  }
+
+  // A loop released just before the end of its slice still fades out in full,
+  // on a middle and the last slice. Over DC slices a cut fade would step by a
+  // large part of 0.25.
+  // Note: ADPCM decodes the take start rising from silence, which a LOOP_ON
+  //       wrap plays as a step, these tests leave slice 0 out
+  void test_loop_release() {
+    enum { SLICE_FRAMES = 1024 };
+    static const uint32_t loops[] = {Effect::LOOP_ON, Effect::LOOP_XFADE};
+    static const uint32_t befores[] = {1, 5, 30, 64, 65};
+    reinit();
+    s_level = 0.25f;
+    record(5 * SLICE_FRAMES, dc, 5);
+    play_mode();
+    float step = 0.f;
+    bool ends = true;
+    for (size_t l = 0; l < sizeof(loops) / sizeof(loops[0]); ++l) {
+      s_effect.setParameter(Effect::LOOP, loops[l]);
+      for (uint32_t slice = 1; slice < 5; slice += 3) {
+        for (size_t k = 0; k < sizeof(befores) / sizeof(befores[0]); ++k) {
+          render(BLOCK_FRAMES, silence);
+          const uint32_t t0 = s_effect.frameCounter() + BLOCK_FRAMES;
+          s_effect.touchEventAt(t0, 0, k_unit_touch_phase_began, slice_x(slice, 5), 0);
+          s_effect.touchEventAt(t0 + 2 * SLICE_FRAMES - befores[k], 0, k_unit_touch_phase_ended, 0, 0);
+          std::vector<float> out;
+          render(5 * SLICE_FRAMES, silence, &out);
+          step = std::fmax(step, max_step(out, 1));
+          ends = ends && nonzero_end(out) < out.size();
+        }
+      }
+    }
+    check(step <= 0.25f * 0.047f && ends,
+          "loop: released just before the end, fades step by at most %.4f per frame, %.4f", step, 0.25f * 0.047f);
+  }
+
+  // A looping voice stolen just before its seam fades out in full, on a
+  // middle and the last slice.
+  void test_loop_steal() {
+    enum { SLICE_FRAMES = 1024 };
+    static const uint32_t loops[] = {Effect::LOOP_ON, Effect::LOOP_XFADE};
+    static const uint32_t befores[] = {1, 3, 10, 40, 64, 100};
+    reinit();
+    s_level = 0.25f;
+    record(5 * SLICE_FRAMES, dc, 5);
+    play_mode();
+    float step = 0.f;
+    for (size_t l = 0; l < sizeof(loops) / sizeof(loops[0]); ++l) {
+      s_effect.setParameter(Effect::LOOP, loops[l]);
+      for (uint32_t oldest = 1; oldest < 5; oldest += 3) {
+        for (size_t k = 0; k < sizeof(befores) / sizeof(befores[0]); ++k) {
+          render(BLOCK_FRAMES, silence);
+          const uint32_t t0 = s_effect.frameCounter() + BLOCK_FRAMES;
+          // The first voice started is the oldest
+          for (uint8_t v = 0; v < Effect::NUM_VOICES; ++v)
+            s_effect.touchEventAt(t0, v, k_unit_touch_phase_began, slice_x(1 + (oldest - 1 + v) % 4, 5), 0);
+          s_effect.touchEventAt(t0 + SLICE_FRAMES - befores[k], 4, k_unit_touch_phase_began, slice_x(2, 5), 0);
+          std::vector<float> out;
+          render(3 * SLICE_FRAMES, silence, &out);
+          step = std::fmax(step, max_step(out, BLOCK_FRAMES + FADE_FRAMES + 1));
+          for (uint8_t v = 0; v <= Effect::NUM_VOICES; ++v)
+            s_effect.touchEvent(v, k_unit_touch_phase_ended, 0, 0);
+          render(3 * SLICE_FRAMES, silence);
+        }
+      }
+    }
+    check(step <= 0.25f * 0.047f, "loop: stolen just before a seam, fades step by at most %.4f per frame, %.4f", step,
+          0.25f * 0.047f);
+  }
+
+} // namespace
+
+int main() {
+  test_interp<2>();
+  test_interp<1>();
+  test_adpcm_snr();
+  test_adpcm_seek();
+  test_adpcm_ring();
+  test_ring_clearing();
+  test_sdram_probe();
+  test_bar_take();
+  test_sync();
+  test_quant_tick();
+  test_fades();
+  test_mip_alias();
+  test_take_end();
+  test_rec_pause();
+  test_idle();
+  test_dry_wet();
+  test_mono();
+  test_mono_odd_end();
+  test_overdub();
+  test_overdub_ramp();
+  test_loop_wrap();
+  test_loop_xfade();
+  test_loop_release();
+  test_loop_steal();
+
+  s_effect.Teardown();
+  host_sdram_release_all();
+
+  std::printf("%u failed\n", s_failures);
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+/*
+ *  File: interpolator.h
+ *
+ *  Interpolation kernels for reading the recorded buffer at a fractional
+ *  32.32 phase. Each kernel is a specialization of Interpolator<> so the play
+ *  loop can be instantiated once per kernel, without a per frame switch. The
+ *  Format policy (see sample_format.h) converts the stored samples, and
+ *  Channels is the number of interleaved channels of a frame, 1 or 2.
+ *
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#include "attributes.h"
+#include "sample_format.h"
+
+enum
+{
+  INTERP_DROP = 0U, // nearest lower frame, no interpolation
+  INTERP_LINEAR,
+  INTERP_HERMITE, // 4-point, 3rd-order Hermite
+  INTERP_SINC,    // 8-point windowed sinc, polyphase table
+  NUM_INTERP_MODES,
+};
+
+// Number of frames kernels may read before and after the current frame.
+// The buffer must provide that many readable guard frames around the
+// recorded area.
+enum
+{
+  INTERP_GUARD_FRAMES = 4
+};
+
+fast_inline float phase_fraction(uint64_t phase)
+{
+  return (uint32_t)phase * (1.f / 4294967296.f);
+}
+
+// All kernels read interleaved frames of Channels channels from buf and
+// write one stereo frame to out, a mono frame is written to both channels.
+template <uint32_t Mode, typename Format = SampleF32, uint32_t Channels = 2>
+struct Interpolator;
+
+// Copy the left channel to the right one when playing mono frames.
+template <uint32_t Channels>
+fast_inline void interp_spread(float *out)
+{
+  if (Channels == 1)
+    out[1] = out[0];
+}
+
+template <typename Format, uint32_t Channels>
+struct Interpolator<INTERP_DROP, Format, Channels>
+{
+  typedef typename Format::sample_t sample_t;
+
+  static fast_inline void render(const sample_t *buf, uint64_t phase, float *out)
+  {
+    const sample_t *x = buf + (uint32_t)(phase >> 32) * Channels;
+    for (uint32_t c = 0; c < Channels; ++c)
+      out[c] = Format::load(x[c]) * Format::scale();
+    interp_spread<Channels>(out);
+  }
+};
+
+template <typename Format, uint32_t Channels>
+struct Interpolator<INTERP_LINEAR, Format, Channels>
+{
+  typedef typename Format::sample_t sample_t;
+
+  static fast_inline void render(const sample_t *buf, uint64_t phase, float *out)
+  {
+    const sample_t *x = buf + (uint32_t)(phase >> 32) * Channels;
+    const float f = phase_fraction(phase);
+    float v[2 * Channels];
+    for (uint32_t k = 0; k < 2 * Channels; ++k)
+      v[k] = Format::load(x[k]);
+    for (uint32_t c = 0; c < Channels; ++c)
+      out[c] = (v[c] + f * (v[Channels + c] - v[c])) * Format::scale();
+    interp_spread<Channels>(out);
+  }
+};
+
+template <typename Format, uint32_t Channels>
+struct Interpolator<INTERP_HERMITE, Format, Channels>
+{
+  typedef typename Format::sample_t sample_t;
+
+  static fast_inline float tap(const sample_t *x, float f)
+  {
+    // x points at frame i of one channel, stride Channels
+    const float xm1 = Format::load(x[-(int32_t)Channels]);
+    const float x0 = Format::load(x[0]);
+    const float x1 = Format::load(x[Channels]);
+    const float x2 = Format::load(x[2 * Channels]);
+    const float c1 = 0.5f * (x1 - xm1);
+    const float c2 = xm1 - 2.5f * x0 + 2.f * x1 - 0.5f * x2;
+    const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * f + c2) * f + c1) * f + x0;
+  }
+
+  static fast_inline void render(const sample_t *buf, uint64_t phase, float *out)
+  {
+    const sample_t *x = buf + (uint32_t)(phase >> 32) * Channels;
+    const float f = phase_fraction(phase);
+    for (uint32_t c = 0; c < Channels; ++c)
+      out[c] = tap(x + c, f) * Format::scale();
+    interp_spread<Channels>(out);
+  }
+};
+
+// Polyphase table of the sinc kernel, shared by every format and layout
+struct SincTable
+{
+  enum
+  {
+    TAPS = 8,        // frames i-3 .. i+4
+    PHASES_BITS = 6, // table rows, interpolated linearly in between
+    PHASES = 1 << PHASES_BITS,
+  };
+
+  typedef float Table[PHASES + 1][TAPS];
+
+  // One extra row so row p + 1 is always valid.
+  static inline Table &table()
+  {
+    static Table t;
+    return t;
+  }
+
+  // Blackman windowed sinc, cutoff slightly below Nyquist, every row
+  // normalized to unity gain. Must be called once before rendering.
+  static void init()
+  {
+    Table &t = table();
+    const float cutoff = 0.9f;
+    const float pi = 3.14159265358979f;
+    for (uint32_t p = 0; p <= PHASES; ++p)
+    {
+      const float f = (float)p / PHASES;
+      float sum = 0.f;
+      for (uint32_t k = 0; k < TAPS; ++k)
+      {
+        const float d = (float)k - 3.f - f; // distance from the read position
+        const float x = pi * cutoff * d;
+        const float sinc = (x == 0.f) ? 1.f : sinf(x) / x;
+        const float w = 0.42f + 0.5f * cosf(pi * d / 4.f) + 0.08f * cosf(2.f * pi * d / 4.f);
+        t[p][k] = sinc * w;
+        sum += t[p][k];
+      }
+      for (uint32_t k = 0; k < TAPS; ++k)
+        t[p][k] /= sum;
+    }
+  }
+};
+
+template <typename Format, uint32_t Channels>
+struct Interpolator<INTERP_SINC, Format, Channels>
+{
+  typedef typename Format::sample_t sample_t;
+
+  enum
+  {
+    TAPS = SincTable::TAPS,
+    PHASES_BITS = SincTable::PHASES_BITS,
+  };
+
+  static fast_inline const SincTable::Table &table()
+  {
+    return SincTable::table();
+  }
+
+  static fast_inline void render(const sample_t *buf, uint64_t phase, float *out)
+  {
+    const sample_t *x = buf + ((int32_t)(phase >> 32) - 3) * (int32_t)Channels;
+    const uint32_t frac = (uint32_t)phase;
+    const uint32_t row = frac >> (32 - PHASES_BITS);
+    const float f = (frac << PHASES_BITS) * (1.f / 4294967296.f);
+    const float *w0 = table()[row];
+    const float *w1 = table()[row + 1];
+
+    // Note: converting the whole window first lets the compiler do it in
+    //       vector registers
+    float v[TAPS * Channels];
+    for (uint32_t k = 0; k < TAPS * Channels; ++k)
+      v[k] = Format::load(x[k]);
+
+    float acc[Channels] = {};
+    for (uint32_t k = 0; k < TAPS; ++k)
+    {
+      const float w = w0[k] + f * (w1[k] - w0[k]);
+      for (uint32_t c = 0; c < Channels; ++c)
+        acc[c] += w * v[Channels * k + c];
+    }
+    for (uint32_t c = 0; c < Channels; ++c)
+      out[c] = acc[c] * Format::scale();
+    interp_spread<Channels>(out);
+  }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ *  File: mipmap.h
+ *
+ *  Half-rate levels of the recorded buffer. Each level is the previous one
+ *  lowpassed by a halfband filter and decimated by two, so reading level N
+ *  at ratio r / 2^N is alias free where reading level 0 at ratio r is not.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+#include "sample_format.h"
+
+enum
+{
+  NUM_MIP_LEVELS = 3, // 1x, 1/2x and 1/4x rate
+};
+
+// 47-tap Kaiser (beta 5.65) windowed halfband lowpass, flat up to 0.21 fs,
+// -60 dB from 0.29 fs. Only the odd taps and the center are non-zero.
+struct HalfbandDecimator
+{
+  enum
+  {
+    HALF_TAPS = 23, // frames read on each side of the center frame
+  };
+
+  // Sum of the samples i frames before and after x
+  template <typename Format, uint32_t Channels>
+  static fast_inline float pair(const typename Format::sample_t *x, int32_t i)
+  {
+    return Format::load(x[-i * (int32_t)Channels]) + Format::load(x[i * (int32_t)Channels]);
+  }
+
+  // x points at the center sample of one channel, stride Channels
+  template <typename Format, uint32_t Channels>
+  static fast_inline float tap(const typename Format::sample_t *x)
+  {
+    return 0.5f * Format::load(x[0])
+         + 3.170476954e-01f * pair<Format, Channels>(x, 1)
+         - 1.019754371e-01f * pair<Format, Channels>(x, 3)
+         + 5.692943107e-02f * pair<Format, Channels>(x, 5)
+         - 3.643159433e-02f * pair<Format, Channels>(x, 7)
+         + 2.438785492e-02f * pair<Format, Channels>(x, 9)
+         - 1.644043664e-02f * pair<Format, Channels>(x, 11)
+         + 1.091580609e-02f * pair<Format, Channels>(x, 13)
+         - 7.015184861e-03f * pair<Format, Channels>(x, 15)
+         + 4.285465169e-03f * pair<Format, Channels>(x, 17)
+         - 2.428636982e-03f * pair<Format, Channels>(x, 19)
+         + 1.224819944e-03f * pair<Format, Channels>(x, 21)
+         - 4.997825997e-04f * pair<Format, Channels>(x, 23);
+  }
+
+  // Compute frames [begin, end) of dst from the interleaved frames of src,
+  // Channels channels each. Reads src frames 2 * begin - HALF_TAPS to
+  // 2 * end + HALF_TAPS - 2. seed feeds the dither of formats that quantize.
+  template <typename Format, uint32_t Channels>
+  static inline void process(const typename Format::sample_t *__restrict src, typename Format::sample_t *__restrict dst,
+                             uint32_t begin, uint32_t end, uint32_t &seed)
+  {
+    const typename Format::sample_t *x = src + begin * 2 * Channels;
+    typename Format::sample_t *y = dst + begin * Channels;
+    uint32_t s = seed;
+    for (uint32_t j = begin; j < end; ++j, x += 2 * Channels, y += Channels)
+      for (uint32_t c = 0; c < Channels; ++c)
+        y[c] = Format::quantize(tap<Format, Channels>(x + c), s);
+    seed = s;
+  }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ *  File: sample_format.h
+ *
+ *  Storage formats for the recorded buffer and its mip levels. Everything
+ *  reading or writing the buffer goes through a format policy, so the format
+ *  is picked once at compile time and costs nothing per frame:
+ *
+ *    SampleF32  32-bit float, samples stored as they come (default)
+ *    SampleQ15  16-bit Q15 with TPDF dither, twice the recording time in the
+ *               same amount of SDRAM
+ *
+ *  Define SAMPLE_STORAGE_Q15 (e.g. in UDEFS) to store Q15. See adpcm.h for
+ *  SAMPLE_STORAGE_ADPCM, which is not a per sample format.
+ *
+ *  Readers work in storage units, load() only converts to float, and apply
+ *  scale() once to what they compute from the samples, so filters and
+ *  interpolators pay a single multiply per output rather than per tap.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+#include "utils/buffer_ops.h" // for buf_clr_f32()
+
+#include "vector_ops.h"
+
+// Noise source for dithering, one LCG step per sample.
+fast_inline uint32_t dither_next(uint32_t &seed)
+{
+  seed = seed * 1664525U + 1013904223U;
+  return seed;
+}
+
+struct SampleF32
+{
+  typedef float sample_t;
+
+  // Full scale value of one storage unit
+  static fast_inline float scale()
+  {
+    return 1.f;
+  }
+
+  static fast_inline float load(sample_t s)
+  {
+    return s;
+  }
+
+  // Round a value in storage units
+  static fast_inline sample_t quantize(float x, uint32_t &seed)
+  {
+    (void)seed;
+    return x;
+  }
+
+  // Convert len float samples from src into dst
+  static fast_inline void store(const float *__restrict src, sample_t *__restrict dst, uint32_t len, uint32_t &seed)
+  {
+    (void)seed;
+    vec_copy_f32(src, dst, len);
+  }
+
+  // Store the mean of both channels of frames stereo frames from src
+  static fast_inline void storeMono(const float *__restrict src, sample_t *__restrict dst, uint32_t frames,
+                                    uint32_t &seed)
+  {
+    (void)seed;
+    for (uint32_t i = 0; i < frames; ++i, src += 2)
+      dst[i] = 0.5f * (src[0] + src[1]);
+  }
+
+  static fast_inline void copy(const sample_t *__restrict src, sample_t *__restrict dst, uint32_t len)
+  {
+    vec_copy_f32(src, dst, len);
+  }
+
+  static fast_inline void clear(sample_t *dst, uint32_t len)
+  {
+    buf_clr_f32(dst, len);
+  }
+};
+
+struct SampleQ15
+{
+  typedef int16_t sample_t;
+
+  static fast_inline float scale()
+  {
+    return 1.f / 32768.f;
+  }
+
+  static fast_inline float load(sample_t s)
+  {
+    return s;
+  }
+
+  // Round to an LSB with triangular (TPDF) dither of +-1 LSB peak, saturating.
+  static fast_inline sample_t quantize(float x, uint32_t &seed)
+  {
+    // The sum of the two 16-bit halves of a random word is triangular over
+    // [0, 2^17 - 2], centered on it gives the dither in 1/65536 LSB.
+    const uint32_t r = dither_next(seed);
+    const float dither = (int32_t)((r & 0xFFFFU) + (r >> 16) - 0xFFFFU) * (1.f / 65536.f);
+    float y = x + dither;
+    y = (y < -32768.f) ? -32768.f : (y > 32767.f) ? 32767.f : y;
+    // Note: round half up, by truncating a value made positive
+    return (sample_t)((int32_t)(y + 32768.5f) - 32768);
+  }
+
+  static fast_inline void store(const float *__restrict src, sample_t *__restrict dst, uint32_t len, uint32_t &seed)
+  {
+    uint32_t s = seed;
+    for (uint32_t i = 0; i < len; ++i)
+      dst[i] = quantize(src[i] * 32768.f, s);
+    seed = s;
+  }
+
+  static fast_inline void storeMono(const float *__restrict src, sample_t *__restrict dst, uint32_t frames,
+                                    uint32_t &seed)
+  {
+    uint32_t s = seed;
+    for (uint32_t i = 0; i < frames; ++i, src += 2)
+      dst[i] = quantize((src[0] + src[1]) * 16384.f, s);
+    seed = s;
+  }
+
+  static fast_inline void copy(const sample_t *__restrict src, sample_t *__restrict dst, uint32_t len)
+  {
+    vec_copy_i16(src, dst, len);
+  }
+
+  static fast_inline void clear(sample_t *dst, uint32_t len)
+  {
+    vec_clr_i16(dst, len);
+  }
+};
+
+#if defined(SAMPLE_STORAGE_Q15)
+typedef SampleQ15 SampleStorage;
+#else
+typedef SampleF32 SampleStorage;
+#endif
@@ -0,0 +1,296 @@
+#pragma once
+
+/*
+ *  File: sample_store.h
+ *
+ *  SDRAM layout of the recorded buffer and its mip levels. The effect decides
+ *  which frames are written, decimated and read; a store decides how they are
+ *  kept. Both stores have the same interface:
+ *
+ *    LinearStore  every level is an array of Format samples, read in place
+ *    AdpcmStore   4-bit IMA-ADPCM, decoded per reader (see adpcm.h)
+ *
+ *  Frame indices never wrap within a call, the effect splits writes at the
+ *  end of a level. In ring mode, readers see the frames at the other end of a
+ *  level past both of its ends.
+ *
+ *  Only LinearStore can overdub, mixing new frames into recorded ones in
+ *  place.
+ *
+ *  Frames are stereo or, for the mono record modes, the mean of both input
+ *  channels. A mono take keeps twice the frames in the same memory. The
+ *  layout is set by reset(), readers are instantiated per layout so the play
+ *  loop does not branch on it.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+#include "utils/int_math.h" // for clipmaxu32()
+#include "interpolator.h"
+#include "mipmap.h"
+#include "sample_format.h"
+
+template <typename Format>
+class LinearStore
+{
+public:
+  typedef Format format_t;
+  typedef typename Format::sample_t sample_t;
+
+  enum
+  {
+    // Most SDRAM for the recorded buffer, the mip levels take half as much
+    // again
+    MAX_BUFFER_BYTES = 0x400000,
+    MAX_FRAMES = MAX_BUFFER_BYTES / sizeof(sample_t) / 2, // stereo interleaved
+    // Buffer sizes are multiples of MIN_FRAMES, so every level holds whole
+    // frames
+    MIN_FRAMES = MAX_FRAMES / 16,
+    // Samples of SDRAM cleared per clearProgressive() call
+    CLEAR_BUDGET_SAMPLES = 1024,
+    // Readable frames around each level, for interpolators and the decimator
+    GUARD_FRAMES = ((int)INTERP_GUARD_FRAMES > (int)HalfbandDecimator::HALF_TAPS) ? (int)INTERP_GUARD_FRAMES : (int)HalfbandDecimator::HALF_TAPS,
+    CAN_OVERDUB = 1,
+  };
+
+  // Size of the single SDRAM block init() takes for a buffer of frames
+  // stereo frames
+  static uint32_t bytes(uint32_t frames)
+  {
+    uint32_t total = 0;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      total += (((frames << 1) >> level) + 4 * GUARD_FRAMES) * sizeof(sample_t);
+    return total;
+  }
+
+  // Stereo frames of the recorded buffer
+  fast_inline uint32_t frames() const
+  {
+    return samples_ >> 1;
+  }
+
+  fast_inline uint32_t channels() const
+  {
+    return channels_;
+  }
+
+  fast_inline uint32_t levelSamples(uint32_t level) const
+  {
+    return samples_ >> level;
+  }
+
+  fast_inline uint32_t levelFrames(uint32_t level) const
+  {
+    return levelSamples(level) / channels_;
+  }
+
+  // A ring take may start on any frame
+  fast_inline uint32_t alignFrames() const
+  {
+    return 1;
+  }
+
+  // Note: memory is not cleared here, which would stall loading. Guard frames
+  //       are cleared by reset(), the rest is cleared ahead of the writers
+  //       and progressively by clearProgressive().
+  inline void init(void *mem, uint32_t frames)
+  {
+    samples_ = frames << 1;
+    sample_t *m = (sample_t *)mem;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      buffers_[level] = m + GUARD_FRAMES * 2;
+      clean_samples_[level] = 0;
+      m += levelSamples(level) + 4 * GUARD_FRAMES;
+    }
+    dither_seed_ = 1;
+    ring_ = false;
+    channels_ = 2;
+  }
+
+  inline void teardown()
+  {
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      buffers_[level] = nullptr;
+  }
+
+  // Start over for a new recording, ring or not, of 1 or 2 channels.
+  inline void reset(bool ring, uint32_t channels)
+  {
+    ring_ = ring;
+    channels_ = channels;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+    {
+      // Guard frames may hold mirrored ring frames, make them silent again
+      sample_t *buf = buffers_[level];
+      if (buf)
+      {
+        Format::clear(buf - GUARD_FRAMES * 2, GUARD_FRAMES * 2);
+        Format::clear(buf + levelSamples(level), GUARD_FRAMES * 2);
+      }
+    }
+  }
+
+  // Voice readers keep nothing between calls
+  inline void invalidate() {}
+
+  // True until the area no writer has reached yet is cleared.
+  inline bool isClearing() const
+  {
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS; ++level)
+      if (clean_samples_[level] < levelSamples(level))
+        return true;
+    return false;
+  }
+
+  // Clear up to CLEAR_BUDGET_SAMPLES of the area no writer has reached yet.
+  inline void clearProgressive()
+  {
+    uint32_t budget = CLEAR_BUDGET_SAMPLES;
+    for (uint32_t level = 0; level < NUM_MIP_LEVELS && budget; ++level)
+    {
+      const uint32_t capacity = levelSamples(level);
+      const uint32_t clean = clean_samples_[level];
+      if (clean >= capacity)
+        continue;
+      const uint32_t n = (capacity - clean < budget) ? capacity - clean : budget;
+      Format::clear(buffers_[level] + clean, n);
+      clean_samples_[level] = clean + n;
+      budget -= n;
+    }
+  }
+
+  // Store frames stereo frames of in at frame of level 0.
+  inline void write(const float *in, uint32_t frame, uint32_t frames)
+  {
+    if (channels_ == 1)
+      Format::storeMono(in, buffers_[0] + frame, frames, dither_seed_);
+    else
+      Format::store(in, buffers_[0] + (frame << 1), frames << 1, dither_seed_);
+    written(0, frame, frame + frames);
+  }
+
+  // Overdub frames stereo frames of in at frame of level 0, in one pass:
+  // out gets in plus the recorded frame, which becomes in plus feedback
+  // times itself. feedback goes by feedback_inc per frame. in and out may be
+  // the same buffer.
+  inline void overdub(const float *in, float *out, uint32_t frame, uint32_t frames, float feedback,
+                      float feedback_inc)
+  {
+    sample_t *buf = buffers_[0] + (frame << 1);
+    uint32_t seed = dither_seed_;
+    for (uint32_t i = 0; i < (frames << 1); i += 2, feedback += feedback_inc)
+    {
+      const float x0 = in[i], x1 = in[i + 1];
+      const float old0 = Format::load(buf[i]) * Format::scale();
+      const float old1 = Format::load(buf[i + 1]) * Format::scale();
+      buf[i] = Format::quantize((feedback * old0 + x0) * (1.f / Format::scale()), seed);
+      buf[i + 1] = Format::quantize((feedback * old1 + x1) * (1.f / Format::scale()), seed);
+      out[i] = x0 + old0;
+      out[i + 1] = x1 + old1;
+    }
+    dither_seed_ = seed;
+    written(0, frame, frame + frames);
+  }
+
+  // A one shot take ends at frame end of a level. Silence the GUARD_FRAMES
+  // frames past it, which may still hold an earlier, longer take, so the
+  // interpolators and the decimator reading past the end see silence.
+  inline void endTake(uint32_t level, uint32_t end)
+  {
+    const uint32_t c = channels_;
+    const uint32_t e = clipmaxu32(end + GUARD_FRAMES, levelFrames(level));
+    if (e <= end)
+      return;
+    Format::clear(buffers_[level] + end * c, (e - end) * c);
+    if (clean_samples_[level] < e * c)
+      clean_samples_[level] = e * c;
+  }
+
+  // Compute frames [begin, end) of a level from the level above. Reads up to
+  // HalfbandDecimator::HALF_TAPS frames of the level above on each side.
+  inline void decimate(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    if (channels_ == 1)
+      HalfbandDecimator::process<Format, 1>(buffers_[level - 1], buffers_[level], begin, end, dither_seed_);
+    else
+      HalfbandDecimator::process<Format, 2>(buffers_[level - 1], buffers_[level], begin, end, dither_seed_);
+    written(level, begin, end);
+  }
+
+  // Buffer a voice reads frames frames of a level from, starting at phase,
+  // in the layout of Channels channels. Every level is read in place, so
+  // phase and frames are kept.
+  template <uint32_t Channels>
+  fast_inline const sample_t *read(uint32_t voice, uint32_t level, uint64_t &phase, uint64_t phase_inc,
+                                   uint32_t &frames)
+  {
+    (void)voice;
+    (void)phase;
+    (void)phase_inc;
+    (void)frames;
+    return buffers_[level];
+  }
+
+private:
+  // Recorded buffer followed by its half and quarter rate versions
+  sample_t *buffers_[NUM_MIP_LEVELS];
+  uint32_t samples_; // of level 0
+
+  // For each level, samples [0, clean_samples_) hold recorded or cleared
+  // data, whatever the layout. Writers keep it GUARD_FRAMES ahead of what they
+  // wrote so readers looking past the end of the take never see uncleared
+  // memory.
+  uint32_t clean_samples_[NUM_MIP_LEVELS];
+
+  // Dither noise state of formats that quantize on write
+  uint32_t dither_seed_;
+
+  bool ring_;
+  uint32_t channels_;
+
+  inline void written(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    markWritten(level, end);
+    if (ring_)
+      mirrorGuards(level, begin, end);
+  }
+
+  // Frames up to end of a level were just written, extend the clean area to
+  // GUARD_FRAMES past them.
+  inline void markWritten(uint32_t level, uint32_t end)
+  {
+    const uint32_t capacity = levelSamples(level);
+    const uint32_t clean = clean_samples_[level];
+    end *= channels_;
+    const uint32_t target = clipmaxu32(end + GUARD_FRAMES * channels_, capacity);
+    if (target <= clean)
+      return;
+    const uint32_t from = (clean > end) ? clean : end;
+    Format::clear(buffers_[level] + from, target - from);
+    clean_samples_[level] = target;
+  }
+
+  // Keep the guard frames around a ring level equal to the frames at the other
+  // end, so readers crossing the wrap point see continuous audio. [begin, end)
+  // is the range of frames just written, not wrapping.
+  inline void mirrorGuards(uint32_t level, uint32_t begin, uint32_t end)
+  {
+    sample_t *buf = buffers_[level];
+    const uint32_t capacity = levelFrames(level);
+    const uint32_t guard = GUARD_FRAMES;
+    const uint32_t c = channels_;
+    if (begin < guard)
+    {
+      const uint32_t e = (end < guard) ? end : guard;
+      Format::copy(buf + begin * c, buf + (capacity + begin) * c, (e - begin) * c);
+    }
+    if (end > capacity - guard)
+    {
+      const uint32_t b = (begin > capacity - guard) ? begin : capacity - guard;
+      Format::copy(buf + b * c, buf - (capacity - b) * c, (end - b) * c);
+    }
+  }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+ *  File: smoother.h
+ *
+ *  Parameter smoothing at block rate.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+
+enum
+{
+  SMOOTH_FRAMES = 480, // full scale ramp time, 10 ms at 48 kHz
+};
+
+// Linear ramp following a target, at most 1 / SMOOTH_FRAMES per frame. The
+// ramp is computed once per block, the render loop only adds the increment.
+struct LinearSmoother
+{
+  float value{0.f};
+
+  fast_inline void reset(float v)
+  {
+    value = v;
+  }
+
+  // Ramp towards target over frames. Returns the value at the first frame and
+  // sets inc to the per frame increment, 0 when the value holds still.
+  fast_inline float ramp(float target, uint32_t frames, float &inc)
+  {
+    const float start = value;
+    const float max = frames * (1.f / SMOOTH_FRAMES);
+    float delta = target - start;
+    delta = (delta > max) ? max : ((delta < -max) ? -max : delta);
+    value = start + delta;
+    inc = (delta != 0.f) ? delta / frames : 0.f;
+    return start;
+  }
+};
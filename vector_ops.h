@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ *  File: vector_ops.h
+ *
+ *  Block operations on sample buffers. Uses CMSIS-DSP on target and plain
+ *  loops the host compiler can vectorize elsewhere.
+ *
+ */
+
+#include <cstdint>
+
+#include "attributes.h"
+
+#if defined(ARM_MATH_CM7) && !defined(UNIT_HOST_BUILD)
+#define VECTOR_OPS_USE_CMSIS 1
+#include "arm_math.h"
+#endif
+
+// dst[i] = src[i], for i in [0, len)
+fast_inline void vec_copy_f32(const float *__restrict src, float *__restrict dst, uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  arm_copy_f32(const_cast<float *>(src), dst, len);
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = src[i];
+#endif
+}
+
+// dst[i] = src[i], for i in [0, len)
+fast_inline void vec_copy_i16(const int16_t *__restrict src, int16_t *__restrict dst, uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  arm_copy_q15(const_cast<int16_t *>(src), dst, len);
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = src[i];
+#endif
+}
+
+// dst[i] = 0, for i in [0, len)
+fast_inline void vec_clr_i16(int16_t *__restrict dst, uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  arm_fill_q15(0, dst, len);
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = 0;
+#endif
+}
+
+// dst[i] = 0, for i in [0, len)
+fast_inline void vec_clr_u8(uint8_t *__restrict dst, uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  arm_fill_q7(0, (q7_t *)dst, len);
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = 0;
+#endif
+}
+
+// dst[i] = scale * src[i], for i in [0, len), src may be dst
+fast_inline void vec_scale_f32(const float *src, float scale, float *dst, uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  arm_scale_f32(const_cast<float *>(src), scale, dst, len);
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = scale * src[i];
+#endif
+}
+
+// dst[i] = dst_gain * dst[i] + src_gain * src[i], for i in [0, len)
+fast_inline void vec_mix_f32(const float *__restrict src, float src_gain, float *__restrict dst, float dst_gain,
+                             uint32_t len)
+{
+#ifdef VECTOR_OPS_USE_CMSIS
+  // Note: scale src by chunks, CMSIS has no fused kernel
+  float tmp[64];
+  while (len)
+  {
+    const uint32_t n = (len < 64) ? len : 64;
+    arm_scale_f32(const_cast<float *>(src), src_gain, tmp, n);
+    arm_scale_f32(dst, dst_gain, dst, n);
+    arm_add_f32(dst, tmp, dst, n);
+    src += n;
+    dst += n;
+    len -= n;
+  }
+#else
+  for (uint32_t i = 0; i < len; ++i)
+    dst[i] = dst_gain * dst[i] + src_gain * src[i];
+#endif
+}
+
+// As vec_mix_f32 on len stereo frames, with dst_gain going from gain at the
+// first frame by inc per frame, and src_gain = 1 - dst_gain
+fast_inline void vec_xfade_ramp_f32(const float *__restrict src, float *__restrict dst, float gain, float inc,
+                                    uint32_t len)
+{
+  // Note: no CMSIS kernel ramps a gain, ramps are short and rare anyway
+  for (uint32_t i = 0; i < len; ++i, src += 2, dst += 2, gain += inc)
+  {
+    dst[0] = gain * dst[0] + (1.f - gain) * src[0];
+    dst[1] = gain * dst[1] + (1.f - gain) * src[1];
+  }
+}